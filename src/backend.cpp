@@ -2,8 +2,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
 #include <time.h>
+#include <vector>
 #include "backend.h"
+#include "font.h"
+#include "sprite.h"
 
 static Color to_raylib(UI::Color color) {
     Color c;
@@ -22,12 +26,118 @@ void ui_fill_rectangle(UI::Rectangle<int> rect, UI::Color color) {
     DrawRectangle(rect.x, rect.y, rect.w, rect.h, to_raylib(color));
 }
 
+/* one texture per font atlas, uploaded the first time the size is drawn.
+ * Glyphs are white, text color is applied as a tint. */
+static struct {
+    int font_size;
+    Texture2D texture;
+} atlas_textures[UI::Fonts::max_atlases];
+static int atlas_texture_count = 0;
+
+static Texture2D atlas_texture(const UI::FontAtlas &atlas) {
+    for(int i = 0; i < atlas_texture_count; i++)
+        if(atlas_textures[i].font_size == atlas.font_size)
+            return atlas_textures[i].texture;
+    Image image;
+    image.width = atlas.width;
+    image.height = atlas.height;
+    image.mipmaps = 1;
+    image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    image.data = MemAlloc(atlas.width * atlas.height * 4);
+    unsigned char *p = (unsigned char*)image.data;
+    for(int y = 0; y < atlas.height; y++) {
+        for(int x = 0; x < atlas.width; x++) {
+            *p++ = 255;
+            *p++ = 255;
+            *p++ = 255;
+            *p++ = atlas.pixel(x, y) ? 255 : 0;
+        }
+    }
+    Texture2D texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    atlas_textures[atlas_texture_count].font_size = atlas.font_size;
+    atlas_textures[atlas_texture_count].texture = texture;
+    atlas_texture_count++;
+    return texture;
+}
+
 void ui_draw_text(const char *msg, UI::Vec2<int> pos, int font_size, UI::Color color) {
-    DrawText(msg, pos.x, pos.y, font_size, to_raylib(color));
+    UI::Fonts &fonts = UI::Fonts::get();
+    const UI::FontAtlas &atlas = fonts.atlas(font_size);
+    Texture2D texture = atlas_texture(atlas);
+    Color tint = to_raylib(color);
+    size_t len = strlen(msg);
+    while(len > 0) {
+        const UI::GlyphRun &run = fonts.layout(msg, len, font_size);
+        for(int i = 0; i < run.length; i++) {
+            UI::Rectangle<int> src = atlas.glyph_rect(run.glyph[i]);
+            Rectangle source = {(float)src.x, (float)src.y, (float)src.w, (float)src.h};
+            Vector2 position = {(float)(pos.x + run.x[i]), (float)pos.y};
+            DrawTextureRec(texture, source, position, tint);
+        }
+        pos.x += run.advance;
+        msg += run.length;
+        len -= run.length;
+    }
 }
 
 int ui_get_text_width(const char *text, int font_size) {
-    return MeasureText(text, font_size);
+    return UI::Fonts::get().text_width(text, font_size);
+}
+
+/* one texture per sprite, decoded from the atlas and uploaded the first time
+ * the sprite is drawn */
+static std::vector<Texture2D> sprite_textures; // id 0 : not uploaded yet
+static size_t texture_bytes = 0;
+
+static Texture2D sprite_texture(int sprite) {
+    if(sprite_textures.size() <= (size_t)sprite) {
+        Texture2D none = {};
+        sprite_textures.resize(sprite + 1, none);
+    }
+    if(sprite_textures[sprite].id != 0)
+        return sprite_textures[sprite];
+    const UI::SpriteAtlas &atlas = UI::SpriteAtlas::get();
+    const UI::Vec2<int> size = atlas.size(sprite);
+    Image image;
+    image.width = size.x;
+    image.height = size.y;
+    image.mipmaps = 1;
+    image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    image.data = MemAlloc(size.x * size.y * 4); // zeroed, transparent
+    for(int y = 0; y < size.y; y++) {
+        const uint8_t *run = atlas.row(sprite, y);
+        unsigned char *p = (unsigned char*)image.data + y * size.x * 4;
+        for(int x = 0; run != nullptr && x < size.x && run + 2 <= atlas.end() && run[0] != 0; run += 2) {
+            const UI::Color c = atlas.color(run[1]);
+            for(int i = 0; i < run[0] && x < size.x; i++, x++, p += 4) {
+                p[0] = c.r;
+                p[1] = c.g;
+                p[2] = c.b;
+                p[3] = c.a != 0 ? 255 : 0;
+            }
+        }
+    }
+    Texture2D texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+    sprite_textures[sprite] = texture;
+    texture_bytes += size.x * size.y * 4;
+    return texture;
+}
+
+void ui_draw_image(int image, UI::Vec2<int> pos) {
+    if(image < 0 || image >= UI::SpriteAtlas::get().count())
+        return;
+    Color white = {255, 255, 255, 255};
+    DrawTexture(sprite_texture(image), pos.x, pos.y, white);
+}
+
+UI::Vec2<int> ui_get_image_size(int image) {
+    return UI::SpriteAtlas::get().size(image);
+}
+
+size_t sprite_texture_bytes(void) {
+    return texture_bytes;
 }
 
 void ui_clip(UI::Rectangle<int> rect) {
@@ -52,13 +162,19 @@ void ui_error(const char *fmt, ...) {
 }
 
 
+uint8_t read_keys(void) {
+    uint8_t keys = 0;
+    if(IsKeyDown(KEY_UP)) keys |= UI::KEY::UP;
+    if(IsKeyDown(KEY_DOWN)) keys |= UI::KEY::DOWN;
+    if(IsKeyDown(KEY_LEFT)) keys |= UI::KEY::LEFT;
+    if(IsKeyDown(KEY_RIGHT)) keys |= UI::KEY::RIGHT;
+    if(IsKeyDown(KEY_ENTER)) keys |= UI::KEY::A;
+    if(IsKeyDown(KEY_BACKSPACE)) keys |= UI::KEY::B;
+    if(IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT)) keys |= UI::KEY::SELECT;
+    if(IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL)) keys |= UI::KEY::START;
+    return keys;
+}
+
 void handle_keys(UI::Context& ui) {
-    ui.set_key_state(UI::KEY::UP, IsKeyDown(KEY_UP));
-    ui.set_key_state(UI::KEY::DOWN, IsKeyDown(KEY_DOWN));
-    ui.set_key_state(UI::KEY::LEFT, IsKeyDown(KEY_LEFT));
-    ui.set_key_state(UI::KEY::RIGHT, IsKeyDown(KEY_RIGHT));
-    ui.set_key_state(UI::KEY::A, IsKeyDown(KEY_ENTER));
-    ui.set_key_state(UI::KEY::B, IsKeyDown(KEY_BACKSPACE));
-    ui.set_key_state(UI::KEY::SELECT, IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT));
-    ui.set_key_state(UI::KEY::START, IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL));
+    ui.set_keys(read_keys());
 }
\ No newline at end of file
@@ -1,2 +1,6 @@
 #include "ui.h"
-void handle_keys(UI::Context &ui);
\ No newline at end of file
+void handle_keys(UI::Context &ui);
+/* the keys currently held, as a UI::KEY bitmask */
+uint8_t read_keys(void);
+/* bytes of sprite textures uploaded so far */
+size_t sprite_texture_bytes(void);
\ No newline at end of file
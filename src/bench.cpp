@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "ui.h"
+#include "soft_backend.h"
+#include "demo.h"
+#include "font.h"
+
+#define TFT_WIDTH 320
+#define TFT_HEIGHT 240
+
+/* Cost of a demo frame with the float input stepped up and down every other
+ * frame, in the float build (bin/ui_bench_float) and the UI_FIXED_POINT one
+ * (bin/ui_bench_fixed), see `make bench`. Frames are built into a draw list
+ * and then rendered by the software backend, the two are timed apart since
+ * the number path only shows in the first. Counts are TSC cycles on x86,
+ * nanoseconds elsewhere. */
+
+UI::Context& ui = UI::Context::get();
+
+static uint64_t cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-n frames]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int frames = 10000;
+    for(int i = 1; i < argc; i++) {
+        if(i + 1 < argc && strcmp(argv[i], "-n") == 0)
+            frames = atoi(argv[++i]);
+        else
+            usage(argv[0]);
+    }
+    UI::Framebuffer &fb = soft_framebuffer();
+    fb.init(TFT_WIDTH, TFT_HEIGHT);
+    UI::Fonts::get().atlas(UI::Style().font_size);
+    soft_set_time(0);
+    ui.init(TFT_WIDTH, TFT_HEIGHT);
+    UI::DrawList list;
+    ui.set_draw_list(&list);
+
+    // two presses of DOWN to get to the float input, then the steps
+    const int warmup = 8;
+    uint64_t build = 0, render = 0;
+    for(int i = 0; i < warmup + frames; i++) {
+        uint8_t keys = 0;
+        if(i < warmup)
+            keys = i % 4 == 1 ? UI::KEY::DOWN : 0;
+        else if(i % 2 == 0)
+            keys = UI::KEY::SELECT | ((i / 200) % 2 ? UI::KEY::DOWN : UI::KEY::UP);
+        soft_set_time(i * 16);
+        ui.set_keys(keys);
+        const uint64_t start = cycles();
+        list.clear();
+        ui.begin_frame();
+        demo_frame();
+        ui.end_frame();
+        const uint64_t built = cycles();
+        fb.clear(UI::Color::black());
+        list.render();
+        const uint64_t rendered = cycles();
+        if(i >= warmup) {
+            build += built - start;
+            render += rendered - built;
+        }
+    }
+#ifdef UI_FIXED_POINT
+    printf("fixed point (Q%d.%d) build\n", 32 - UI_FIXED_FRAC, UI_FIXED_FRAC);
+#else
+    printf("float build\n");
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+    const char *unit = "cycles";
+#else
+    const char *unit = "ns";
+#endif
+    printf("  build  %8lu %s per frame\n", (unsigned long)(build / frames), unit);
+    printf("  render %8lu %s per frame\n", (unsigned long)(render / frames), unit);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <cstdio>
+#include <algorithm>
+#include "demo.h"
+#include "sprite.h"
+
+static UI::Context& ui = UI::Context::get();
+
+static int page = 0;
+
+/* the icon from the sprite atlas, nothing if it isn't loaded */
+static void icon(const char *name) {
+    const int sprite = UI::SpriteAtlas::get().find(name);
+    if(sprite >= 0)
+        ui.image(sprite);
+}
+
+static void menu() {
+    ui.begin_container("margin");
+    ui.h_space(20);
+    ui.end_container();
+    ui.begin_container("column1");
+    icon("button");
+    ui.label("button");
+    ui.nextline();
+    icon("number");
+    ui.label("int");
+    ui.nextline();
+    icon("decimal");
+    ui.label("float");
+    ui.nextline();
+    icon("list");
+    ui.label("listbox");
+    ui.nextline();
+    icon("text");
+    ui.label("textbox");
+    ui.nextline();
+    icon("paragraph");
+    ui.label("paragraph");
+    ui.end_container();
+    ui.begin_container("column2");
+    if(ui.button("page 1"))
+        page = 1;
+    ui.nextline();
+    static int x;
+    ui.input_number<int>(&x, 0, 100, 10);
+    ui.nextline();
+    static UI::real f;
+    ui.input_number<UI::real>(&f, 0, 100, UI::real_ratio(1, 10));
+    ui.nextline();
+    static int selected = 0;
+    static const char *const items[] = {"foo", "bar", "baz"};
+    ui.listbox(&selected, items, UI_ARRAY_SIZE(items));
+    ui.nextline();
+    static UI::String text = "HELLO";
+    if(ui.input_text(text, 0))
+        printf("new text: %s\n", text.c_str());
+    ui.nextline();
+    if(ui.button("page 2"))
+        page = 2;
+    ui.end_container();
+}
+
+static void page1() {
+    const int rows = 20, cols = 5;
+    const UI::Style style;
+    static const int label_width = [&]() {
+        int w = 0;
+        char label[32];
+        for(int i = 0; i < rows * cols; i++) {
+            snprintf(label, sizeof(label), "Button %d", i);
+            w = std::max(w, ui_get_text_width(label, style.font_size));
+        }
+        return w;
+    }();
+    const UI::Vec2<int> cell(label_width + 2 * style.padding, style.font_size + 2 * style.padding);
+    int clicked = ui.grid("buttons", rows * cols, cols, cell, [](int index, char *buf, size_t size) {
+        snprintf(buf, size, "Button %d", index);
+        return (const char*)buf;
+    });
+    if(clicked >= 0)
+        printf("Button %d clicked!\n", clicked);
+    ui.nextline();
+    static bool checked = false;
+    ui.checkbox(&checked);
+    if(checked) {
+        if(ui.button("hidden button")) {
+            printf("hidden button clicked!\n");
+            page = 0;
+        }
+    }
+}
+
+static void page2() {
+    if(ui.button("back"))
+        page = 0;
+    ui.nextline();
+    ui.paragraph("help", "A log gets a line every 20 frames, only the last one is reflowed.");
+    ui.nextline();
+    static char log[1024];
+    static size_t log_size = 0;
+    static int frames = 0;
+    if(frames++ % 20 == 0) {
+        if(log_size > sizeof(log) - 64)
+            log_size = 0;
+        log_size += snprintf(log + log_size, sizeof(log) - log_size, "%sframe %d: everything is fine",
+            log_size > 0 ? "\n" : "", frames);
+    }
+    ui.set_next_widget_size(300, 140);
+    ui.paragraph("log", log, true);
+}
+
+void demo_frame(void) {
+    ui.begin_container("root");
+    if(!ui.is_keyboard_displayed()) {
+        switch(page) {
+            case 0:
+                menu();
+                break;
+            case 1:
+                page1();
+                break;
+            case 2:
+                page2();
+                break;
+        }
+    }
+    ui.end_container();
+}
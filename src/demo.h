@@ -0,0 +1,3 @@
+#include "ui.h"
+/* builds the demo pages, between begin_frame() and end_frame() */
+void demo_frame(void);
@@ -0,0 +1,137 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ui.h"
+#include "soft_backend.h"
+#include "font.h"
+#include "sprite.h"
+#include "stream.h"
+
+#define TFT_WIDTH 320
+#define TFT_HEIGHT 240
+
+/* Reference display server : takes one client on a Unix-domain socket,
+ * decodes the draw list stream (see stream.h) and rasterizes every frame
+ * into the software framebuffer. Reports the bytes per frame and the
+ * latency from the client sending a frame to it being rasterized here.
+ * Images are drawn from the sprite atlas given with -a, which must be the
+ * one the client uses. */
+
+static bool read_all(int fd, uint8_t *data, size_t size) {
+    while(size > 0) {
+        ssize_t n = read(fd, data, size);
+        if(n <= 0)
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static int listen_on(const char *path) {
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr.sun_path))
+        return -1;
+    strcpy(addr.sun_path, path);
+    unlink(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+        return -1;
+    if(bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 1) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s socket [-o screenshot.ppm] [-a sprite_atlas]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    const char *screenshot = NULL;
+    const char *sprite_path = NULL;
+    for(int i = 1; i < argc; i++) {
+        if(i + 1 < argc && strcmp(argv[i], "-o") == 0)
+            screenshot = argv[++i];
+        else if(i + 1 < argc && strcmp(argv[i], "-a") == 0)
+            sprite_path = argv[++i];
+        else if(argv[i][0] != '-' && path == NULL)
+            path = argv[i];
+        else
+            usage(argv[0]);
+    }
+    if(path == NULL)
+        usage(argv[0]);
+    if(sprite_path != NULL && !UI::SpriteAtlas::get().open(sprite_path)) {
+        fprintf(stderr, "can't open sprite atlas %s\n", sprite_path);
+        return 1;
+    }
+
+    int server = listen_on(path);
+    if(server < 0) {
+        fprintf(stderr, "can't listen on %s\n", path);
+        return 1;
+    }
+    int client = accept(server, NULL, NULL);
+    if(client < 0) {
+        fprintf(stderr, "accept failed\n");
+        return 1;
+    }
+
+    UI::Framebuffer &fb = soft_framebuffer();
+    fb.init(TFT_WIDTH, TFT_HEIGHT);
+    UI::DrawListDecoder decoder;
+    std::vector<uint8_t> payload;
+    uint8_t raw_header[UI::StreamHeader::size];
+    unsigned long frames = 0, bytes = 0, keyframes = 0, errors = 0;
+    uint64_t total_latency = 0, max_latency = 0;
+    while(read_all(client, raw_header, sizeof(raw_header))) {
+        UI::StreamHeader header;
+        if(!header.parse(raw_header)) {
+            fprintf(stderr, "bad packet header\n");
+            break;
+        }
+        payload.resize(header.payload_size);
+        if(!read_all(client, payload.data(), payload.size()))
+            break;
+        const UI::DrawList *list = decoder.decode(header, payload.data());
+        if(list == nullptr) {
+            errors++;
+            continue;
+        }
+        fb.clear(UI::Color::black());
+        list->render();
+        uint64_t latency = UI::stream_clock() - header.timestamp;
+        total_latency += latency;
+        if(latency > max_latency)
+            max_latency = latency;
+        frames++;
+        bytes += sizeof(raw_header) + payload.size();
+        if(header.flags & UI::STREAM_KEYFRAME)
+            keyframes++;
+    }
+    close(client);
+    close(server);
+    unlink(path);
+
+    printf("frames: %lu (%lu keyframes), %lu undecodable\n", frames, keyframes, errors);
+    if(frames > 0) {
+        printf("bytes per frame: %lu mean\n", bytes / frames);
+        printf("latency: %lu us mean, %lu us max\n", (unsigned long)(total_latency / frames), (unsigned long)max_latency);
+    }
+    const UI::SpriteAtlas &sprites = UI::SpriteAtlas::get();
+    if(sprites.count() > 0)
+        printf("sprites: %d, %zu bytes mapped, %zu resident\n", sprites.count(), sprites.mapped_bytes(), sprites.resident_bytes());
+    if(screenshot != NULL && !fb.write_ppm(screenshot))
+        fprintf(stderr, "can't write %s\n", screenshot);
+    return errors == 0 ? 0 : 2;
+}
@@ -0,0 +1,362 @@
+#include <cstdio>
+#include <cstring>
+#ifndef UI_NO_HEAP
+#include <atomic>
+#include <mutex>
+#endif
+#include "font.h"
+
+namespace UI {
+
+/* font8x8_basic by Daniel Hepper (public domain), printable ascii only.
+ * One byte per row, bit 0 is the leftmost pixel. */
+static const uint8_t font8x8[FontAtlas::glyph_count][8] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 }, // '!'
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '"'
+    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 }, // '#'
+    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 }, // '$'
+    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 }, // '%'
+    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 }, // '&'
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '''
+    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 }, // '('
+    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 }, // ')'
+    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 }, // '*'
+    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 }, // '+'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ','
+    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 }, // '-'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // '.'
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 }, // '/'
+    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 }, // '0'
+    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 }, // '1'
+    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 }, // '2'
+    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 }, // '3'
+    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 }, // '4'
+    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 }, // '5'
+    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 }, // '6'
+    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 }, // '7'
+    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 }, // '8'
+    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 }, // '9'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 }, // ':'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 }, // ';'
+    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 }, // '<'
+    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 }, // '='
+    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 }, // '>'
+    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 }, // '?'
+    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 }, // '@'
+    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 }, // 'A'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 }, // 'B'
+    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 }, // 'C'
+    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 }, // 'D'
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 }, // 'E'
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 }, // 'F'
+    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 }, // 'G'
+    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 }, // 'H'
+    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'I'
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 }, // 'J'
+    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 }, // 'K'
+    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 }, // 'L'
+    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 }, // 'M'
+    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 }, // 'N'
+    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 }, // 'O'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 }, // 'P'
+    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 }, // 'Q'
+    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 }, // 'R'
+    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 }, // 'S'
+    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'T'
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 }, // 'U'
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'V'
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 }, // 'W'
+    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 }, // 'X'
+    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 }, // 'Y'
+    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 }, // 'Z'
+    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 }, // '['
+    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 }, // '\'
+    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 }, // ']'
+    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, // '^'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF }, // '_'
+    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '`'
+    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 }, // 'a'
+    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 }, // 'b'
+    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 }, // 'c'
+    { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 }, // 'd'
+    { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 }, // 'e'
+    { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 }, // 'f'
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'g'
+    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 }, // 'h'
+    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'i'
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E }, // 'j'
+    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 }, // 'k'
+    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 }, // 'l'
+    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 }, // 'm'
+    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 }, // 'n'
+    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 }, // 'o'
+    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F }, // 'p'
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 }, // 'q'
+    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 }, // 'r'
+    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 }, // 's'
+    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 }, // 't'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 }, // 'u'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 }, // 'v'
+    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 }, // 'w'
+    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 }, // 'x'
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F }, // 'y'
+    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 }, // 'z'
+    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 }, // '{'
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, // '|'
+    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 }, // '}'
+    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // '~'
+};
+
+/* FontAtlas **************************************************************** */
+
+/* atlas file : "UIFA", version, font size, cell, spacing, width and height
+ * (16 bit little endian), x offsets, ink widths, then the 1bpp rows */
+static const char atlas_magic[4] = {'U', 'I', 'F', 'A'};
+static const uint8_t atlas_version = 1;
+
+bool FontAtlas::bake(int font_size) {
+    if(!can_bake(font_size))
+        return false;
+    const int rows = (glyph_count + columns - 1) / columns;
+    this->font_size = font_size;
+    cell = font_size;
+    spacing = font_size / 8 > 0 ? font_size / 8 : 1;
+    width = columns * cell;
+    height = rows * cell;
+    stride = (width + 7) / 8;
+    bits.assign(stride * height, 0);
+    for(int g = 0; g < glyph_count; g++) {
+        const uint8_t *src = font8x8[g];
+        uint8_t ink = 0;
+        for(int y = 0; y < 8; y++)
+            ink |= src[y];
+        if(ink == 0) { // space
+            x_offset[g] = 0;
+            ink_width[g] = cell * 3 / 8;
+            continue;
+        }
+        int min_col = 0, max_col = 7;
+        while(!(ink & (1 << min_col))) min_col++;
+        while(!(ink & (1 << max_col))) max_col--;
+        x_offset[g] = min_col * cell / 8;
+        ink_width[g] = ((max_col + 1) * cell + 7) / 8 - x_offset[g];
+        const int cx = (g % columns) * cell, cy = (g / columns) * cell;
+        for(int y = 0; y < cell; y++) {
+            const uint8_t row = src[y * 8 / cell];
+            for(int x = 0; x < cell; x++) {
+                if(row & (1 << (x * 8 / cell)))
+                    bits[(cy + y) * stride + ((cx + x) >> 3)] |= 0x80 >> ((cx + x) & 7);
+            }
+        }
+    }
+    return true;
+}
+
+static void put_u16(FILE *f, int v) {
+    fputc(v & 0xff, f);
+    fputc((v >> 8) & 0xff, f);
+}
+
+static int get_u16(FILE *f) {
+    int lo = fgetc(f);
+    int hi = fgetc(f);
+    if(lo == EOF || hi == EOF)
+        return -1;
+    return lo | (hi << 8);
+}
+
+bool FontAtlas::save(const char *path) const {
+    FILE *f = fopen(path, "wb");
+    if(f == NULL)
+        return false;
+    fwrite(atlas_magic, 1, sizeof(atlas_magic), f);
+    fputc(atlas_version, f);
+    fputc(font_size, f);
+    fputc(cell, f);
+    fputc(spacing, f);
+    put_u16(f, width);
+    put_u16(f, height);
+    fwrite(x_offset, 1, glyph_count, f);
+    fwrite(ink_width, 1, glyph_count, f);
+    fwrite(bits.data(), 1, bits.size(), f);
+    bool ok = !ferror(f);
+    return fclose(f) == 0 && ok;
+}
+
+bool FontAtlas::load(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if(f == NULL)
+        return false;
+    char magic[4];
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic)
+        && memcmp(magic, atlas_magic, sizeof(magic)) == 0
+        && fgetc(f) == atlas_version;
+    if(ok) {
+        font_size = fgetc(f);
+        cell = fgetc(f);
+        spacing = fgetc(f);
+        width = get_u16(f);
+        height = get_u16(f);
+        stride = (width + 7) / 8;
+        const int rows = (glyph_count + columns - 1) / columns;
+        ok = font_size > 0 && cell > 0 && spacing >= 0 && width >= columns * cell
+            && height >= rows * cell && (size_t)stride * height <= bits.max_size();
+    }
+    if(ok) {
+        bits.resize(stride * height);
+        ok = fread(x_offset, 1, glyph_count, f) == glyph_count
+            && fread(ink_width, 1, glyph_count, f) == glyph_count
+            && fread(bits.data(), 1, bits.size(), f) == bits.size();
+    }
+    for(int g = 0; ok && g < glyph_count; g++)
+        ok = x_offset[g] + ink_width[g] <= cell; // glyphs stay in their cell
+    fclose(f);
+    return ok;
+}
+
+/* Fonts ******************************************************************** */
+
+#ifndef UI_NO_HEAP
+/* atlases loaded by any thread, copied into each thread's instance when
+ * the generation moves */
+static std::mutex loaded_mutex;
+static FontAtlas loaded_atlases[Fonts::max_atlases];
+static int loaded_count = 0;
+static std::atomic<unsigned> loaded_generation(0);
+
+void Fonts::sync_loaded() {
+    std::lock_guard<std::mutex> lock(loaded_mutex);
+    for(int i = 0; i < loaded_count; i++)
+        install(loaded_atlases[i]);
+    synced_generation = loaded_generation.load();
+}
+#endif
+
+FontAtlas &Fonts::atlas(int font_size) {
+#ifndef UI_NO_HEAP
+    if(synced_generation != loaded_generation.load(std::memory_order_relaxed))
+        sync_loaded();
+#endif
+    for(int i = 0; i < atlas_count; i++)
+        if(atlases[i].font_size == font_size)
+            return atlases[i];
+    if(atlas_count == max_atlases)
+        ui_error("too many font sizes (max %d)", max_atlases);
+    FontAtlas &atlas = atlases[atlas_count];
+    if(!atlas.bake(font_size))
+        ui_error("can't bake a font atlas of size %d", font_size);
+    atlas_count++;
+    return atlas;
+}
+
+bool Fonts::load(const char *path) {
+    FontAtlas atlas;
+    if(!atlas.load(path))
+        return false;
+#ifdef UI_NO_HEAP
+    return install(atlas);
+#else
+    {
+        std::lock_guard<std::mutex> lock(loaded_mutex);
+        int i = 0;
+        while(i < loaded_count && loaded_atlases[i].font_size != atlas.font_size)
+            i++;
+        if(i == max_atlases)
+            return false;
+        loaded_atlases[i] = atlas;
+        if(i == loaded_count)
+            loaded_count++;
+        loaded_generation++;
+    }
+    sync_loaded();
+    return true;
+#endif
+}
+
+bool Fonts::install(const FontAtlas &atlas) {
+    int i = 0;
+    while(i < atlas_count && atlases[i].font_size != atlas.font_size)
+        i++;
+    if(i == max_atlases)
+        return false;
+    atlases[i] = atlas;
+    if(i == atlas_count)
+        atlas_count++;
+    for(int r = 0; r < run_cache_size; r++) { // laid out with the old advances
+        if(runs[r].font_size == atlas.font_size) {
+            runs[r].font_size = 0;
+            runs[r].length = 0;
+        }
+    }
+    return true;
+}
+
+static uint32_t run_hash(const char *text, size_t len, int font_size) {
+    uint32_t h = 2166136261u ^ (uint32_t)font_size;
+    while(len--)
+        h = (h ^ (unsigned char)*text++) * 16777619u;
+    return h;
+}
+
+void Fonts::layout_run(GlyphRun &run, const char *text, size_t len, FontAtlas &atlas) {
+    if(len > GlyphRun::max_length)
+        len = GlyphRun::max_length;
+    int pen = 0;
+    for(size_t i = 0; i < len; i++) {
+        const int g = FontAtlas::glyph_index(text[i]);
+        run.text[i] = text[i];
+        run.glyph[i] = g;
+        run.x[i] = pen;
+        pen += atlas.advance(g);
+    }
+    run.font_size = atlas.font_size;
+    run.length = len;
+    run.advance = pen;
+}
+
+const GlyphRun &Fonts::layout(const char *text, size_t len, int font_size) {
+    if(len > GlyphRun::max_length) {
+        layout_run(scratch, text, len, atlas(font_size));
+        return scratch;
+    }
+    /* 4-way set associative, least recently used slot of the set is evicted */
+    const int ways = 4;
+    const uint32_t h = run_hash(text, len, font_size);
+    GlyphRun *set = &runs[(h % (run_cache_size / ways)) * ways];
+    GlyphRun *victim = &set[0];
+    clock++;
+    for(int i = 0; i < ways; i++) {
+        GlyphRun &run = set[i];
+        if(run.hash == h && run.font_size == font_size && run.length == (int)len
+            && memcmp(run.text, text, len) == 0) {
+            run.last_use = clock;
+            hits++;
+            return run;
+        }
+        // empty slots first, then the oldest (ages survive the clock wrapping)
+        if(victim->length != 0 && (run.length == 0 || clock - run.last_use > clock - victim->last_use))
+            victim = &run;
+    }
+    misses++;
+    layout_run(*victim, text, len, atlas(font_size));
+    victim->hash = h;
+    victim->last_use = clock;
+    return *victim;
+}
+
+int Fonts::text_width(const char *text, int font_size) {
+    size_t len = strlen(text);
+    if(len == 0)
+        return 0;
+    int width = 0;
+    while(len > 0) {
+        const GlyphRun &run = layout(text, len, font_size);
+        width += run.advance;
+        text += run.length;
+        len -= run.length;
+    }
+    return width - atlas(font_size).spacing;
+}
+
+} // namespace UI
@@ -0,0 +1,122 @@
+#ifndef FONT_H
+#define FONT_H
+
+#include <cstdint>
+#include "ui.h"
+
+namespace UI {
+
+/* Bitmap font atlas ******************************************************** */
+/* The built-in 8x8 font is scaled (nearest neighbour) to the requested font
+ * size and packed into a 1 bit per pixel atlas of 16 x 6 cells. Glyphs are
+ * proportional : each one has its own ink rectangle inside its cell and its
+ * own advance. With UI_NO_HEAP the bits live in the atlas itself, which caps
+ * the font size at UI_MAX_FONT_SIZE. */
+class FontAtlas {
+public:
+    static const int first_char = 32;
+    static const int glyph_count = 95; // printable ascii, 32..126
+    static const int columns = 16;
+
+    /* the sizes bake() accepts, see UI_MAX_FONT_SIZE */
+    static bool can_bake(int font_size) {
+#ifdef UI_NO_HEAP
+        return font_size > 0 && font_size <= UI_MAX_FONT_SIZE;
+#else
+        return font_size > 0 && font_size <= 255;
+#endif
+    }
+    bool bake(int font_size);
+    bool load(const char *path);
+    bool save(const char *path) const;
+
+    static int glyph_index(unsigned char c) {
+        if(c < first_char || c >= first_char + glyph_count)
+            c = '?';
+        return c - first_char;
+    }
+    Rectangle<int> glyph_rect(int glyph) const {
+        return Rectangle<int>((glyph % columns) * cell + x_offset[glyph], (glyph / columns) * cell, ink_width[glyph], cell);
+    }
+    int advance(int glyph) const { return ink_width[glyph] + spacing; }
+    bool pixel(int x, int y) const { return bits[y * stride + (x >> 3)] & (0x80 >> (x & 7)); }
+
+    int font_size = 0;
+    int cell = 0, spacing = 0;
+    int width = 0, height = 0, stride = 0; // atlas size in pixels, bytes per row
+    uint8_t x_offset[glyph_count];
+    uint8_t ink_width[glyph_count];
+    Vector<uint8_t, 12 * UI_MAX_FONT_SIZE * UI_MAX_FONT_SIZE> bits;
+};
+
+/* Glyph runs *************************************************************** */
+/* A laid-out string : glyph indices and their x offsets from the pen
+ * position. Strings longer than max_length are laid out in several runs,
+ * the next one starting at the pen position plus advance. */
+class GlyphRun {
+public:
+    static const int max_length = 48;
+    uint32_t hash = 0;
+    int font_size = 0;
+    int length = 0;
+    int advance = 0; // pen displacement, including the trailing spacing
+    uint32_t last_use = 0;
+    char text[max_length];
+    uint8_t glyph[max_length];
+    int16_t x[max_length];
+};
+
+/* Atlases for every font size in use, and a cache of glyph runs for the
+ * strings drawn over and over (labels, buttons, keyboard keys). Backends call
+ * layout() and blit the glyphs from atlas(). There is one instance per
+ * thread, so a render thread (see pipeline.h) never shares the cache with the
+ * thread measuring text, and atlases loaded by any thread are picked up by
+ * all of them. With UI_NO_HEAP there is a single instance instead, for
+ * targets with one thread and no thread-local storage. */
+class Fonts {
+public:
+    static Fonts& get() {
+#ifdef UI_NO_HEAP
+        static Fonts instance;
+#else
+        static thread_local Fonts instance;
+#endif
+        return instance;
+    }
+    Fonts(Fonts const&) = delete;
+    void operator=(Fonts const&) = delete;
+
+    static const int max_atlases = 4;
+    static const int run_cache_size = 64;
+
+    /* bakes the atlas for font_size if it isn't there yet */
+    FontAtlas &atlas(int font_size);
+    /* loads a prebuilt atlas (see FontAtlas::save) instead of baking it, for
+     * every thread */
+    bool load(const char *path);
+    /* lays out (at most GlyphRun::max_length of) the len first characters */
+    const GlyphRun &layout(const char *text, size_t len, int font_size);
+    int text_width(const char *text, int font_size);
+
+    unsigned long hits = 0, misses = 0;
+
+private:
+    Fonts() {}
+    void layout_run(GlyphRun &run, const char *text, size_t len, FontAtlas &atlas);
+    /* adds the atlas, or replaces the one of the same size, false if full */
+    bool install(const FontAtlas &atlas);
+#ifndef UI_NO_HEAP
+    void sync_loaded();
+    unsigned synced_generation = 0; // of the loaded atlases last installed
+#endif
+
+    FontAtlas atlases[max_atlases];
+    int atlas_count = 0;
+    GlyphRun runs[run_cache_size];
+    GlyphRun scratch; // chunks of strings that don't fit in a run aren't cached
+    uint32_t clock = 1; // bumped on every lookup, for LRU eviction
+};
+
+} // namespace UI
+
+#endif
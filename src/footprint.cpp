@@ -0,0 +1,69 @@
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "ui.h"
+#include "soft_backend.h"
+#include "demo.h"
+#include "font.h"
+
+#ifndef UI_NO_HEAP
+#error "footprint.cpp is built with UI_NO_HEAP, see the footprint target in the Makefile"
+#endif
+
+#define TFT_WIDTH 320
+#define TFT_HEIGHT 240
+
+/* Runs the demo in the no-heap configuration, checks that frames don't touch
+ * the heap and reports the static RAM taken by the ui. */
+
+static unsigned long allocations = 0;
+
+void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size);
+    if(p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+UI::Context& ui = UI::Context::get();
+
+int main(void) {
+    UI::Framebuffer &fb = soft_framebuffer();
+    fb.init(TFT_WIDTH, TFT_HEIGHT);
+    UI::Fonts::get().atlas(UI::Style().font_size);
+    ui.init(TFT_WIDTH, TFT_HEIGHT);
+
+    const unsigned long before = allocations;
+    const int frames = 100;
+    for(int i = 0; i < frames; i++) {
+        // open page 1 (the button grid), then walk down it
+        ui.set_keys(i == 2 ? UI::KEY::A : i > 5 && i % 10 == 0 ? UI::KEY::DOWN : 0);
+        ui.begin_frame();
+        fb.clear(UI::Color::black());
+        demo_frame();
+        ui.end_frame();
+    }
+    const unsigned long extra = allocations - before;
+
+    printf("UI_NO_HEAP configuration\n");
+    printf("  containers %d, id stack %d, widgets %d, text %d, paragraphs %d x %d lines, font size %d\n",
+        UI_MAX_CONTAINERS, UI_MAX_ID_STACK, UI_MAX_WIDGETS, UI_MAX_TEXT, UI_MAX_TEXT_LAYOUTS, UI_MAX_TEXT_LINES,
+        UI_MAX_FONT_SIZE);
+    printf("static RAM\n");
+    printf("  UI::Context         %6zu bytes\n", sizeof(UI::Context));
+    printf("    widget table      %6zu bytes\n", sizeof(UI::Map<UI::ui_id, UI::Vec2<int>, UI_MAX_WIDGETS>));
+    printf("    container stack   %6zu bytes\n", sizeof(UI::Vector<UI::Container, UI_MAX_CONTAINERS>));
+    printf("    id stack          %6zu bytes\n", sizeof(UI::IDStack));
+    printf("    paragraph layouts %6zu bytes\n", sizeof(UI::Vector<UI::TextLayout, UI_MAX_TEXT_LAYOUTS>));
+    printf("  UI::String          %6zu bytes each\n", sizeof(UI::String));
+    printf("  UI::DrawList        %6zu bytes each, if used\n", sizeof(UI::DrawList));
+    printf("  UI::Fonts           %6zu bytes\n", sizeof(UI::Fonts));
+    printf("    font atlases      %6zu bytes\n", UI::Fonts::max_atlases * sizeof(UI::FontAtlas));
+    printf("heap allocations in %d frames: %lu\n", frames, extra);
+    return extra == 0 ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include "framebuffer.h"
+#include "font.h"
+#include "sprite.h"
+
+namespace UI {
+
+void Framebuffer::init(int w, int h) {
+    width = w;
+    height = h;
+    pixels.assign(w * h, 0);
+    clip_end();
+}
+
+void Framebuffer::clear(Color color) {
+    std::fill(pixels.begin(), pixels.end(), pack(color));
+}
+
+void Framebuffer::fill_span(int x0, int x1, int y, uint16_t color) {
+    if(y < clip_rect.y || y >= clip_rect.y + clip_rect.h)
+        return;
+    x0 = std::max(x0, clip_rect.x);
+    x1 = std::min(x1, clip_rect.x + clip_rect.w);
+    if(x0 >= x1)
+        return;
+    std::fill(&pixels[y * width + x0], &pixels[y * width + x1], color);
+}
+
+void Framebuffer::fill_rectangle(Rectangle<int> rect, Color color) {
+    const uint16_t c = pack(color);
+    const int y0 = std::max(rect.y, clip_rect.y);
+    const int y1 = std::min(rect.y + rect.h, clip_rect.y + clip_rect.h);
+    for(int y = y0; y < y1; y++)
+        fill_span(rect.x, rect.x + rect.w, y, c);
+}
+
+void Framebuffer::draw_rectangle(Rectangle<int> rect, Color color) {
+    if(rect.w <= 0 || rect.h <= 0)
+        return;
+    const uint16_t c = pack(color);
+    fill_span(rect.x, rect.x + rect.w, rect.y, c);
+    fill_span(rect.x, rect.x + rect.w, rect.y + rect.h - 1, c);
+    for(int y = rect.y + 1; y < rect.y + rect.h - 1; y++) {
+        fill_span(rect.x, rect.x + 1, y, c);
+        fill_span(rect.x + rect.w - 1, rect.x + rect.w, y, c);
+    }
+}
+
+void Framebuffer::draw_text(const char *msg, Vec2<int> pos, int font_size, Color color) {
+    Fonts &fonts = Fonts::get();
+    const FontAtlas &atlas = fonts.atlas(font_size);
+    const uint16_t c = pack(color);
+    const int y0 = std::max(pos.y, clip_rect.y);
+    const int y1 = std::min(pos.y + atlas.cell, clip_rect.y + clip_rect.h);
+    if(y0 >= y1)
+        return;
+    size_t len = strlen(msg);
+    while(len > 0) {
+        const GlyphRun &run = fonts.layout(msg, len, font_size);
+        for(int i = 0; i < run.length; i++) {
+            const Rectangle<int> src = atlas.glyph_rect(run.glyph[i]);
+            const int dx = pos.x + run.x[i];
+            const int x0 = std::max(dx, clip_rect.x);
+            const int x1 = std::min(dx + src.w, clip_rect.x + clip_rect.w);
+            if(x0 >= x1)
+                continue;
+            for(int y = y0; y < y1; y++) {
+                uint16_t *dst = &pixels[y * width];
+                const int sy = src.y + y - pos.y;
+                for(int x = x0; x < x1; x++)
+                    if(atlas.pixel(src.x + x - dx, sy))
+                        dst[x] = c;
+            }
+        }
+        pos.x += run.advance;
+        msg += run.length;
+        len -= run.length;
+    }
+}
+
+void Framebuffer::draw_image(int sprite, Vec2<int> pos) {
+    const SpriteAtlas &atlas = SpriteAtlas::get();
+    const Vec2<int> size = atlas.size(sprite);
+    const int y0 = std::max(pos.y, clip_rect.y);
+    const int y1 = std::min(pos.y + size.y, clip_rect.y + clip_rect.h);
+    const int x_end = std::min(pos.x + size.x, clip_rect.x + clip_rect.w);
+    for(int y = y0; y < y1; y++) {
+        const uint8_t *run = atlas.row(sprite, y - pos.y);
+        if(run == nullptr)
+            continue;
+        uint16_t *dst = &pixels[y * width];
+        // runs left of the clip rectangle only move x
+        for(int x = pos.x; x < x_end && run + 2 <= atlas.end() && run[0] != 0; run += 2) {
+            const int x0 = std::max(x, clip_rect.x), x1 = std::min(x + run[0], x_end);
+            x += run[0];
+            const Color c = atlas.color(run[1]);
+            if(x0 < x1 && c.a != 0)
+                std::fill(dst + x0, dst + x1, pack(c));
+        }
+    }
+}
+
+void Framebuffer::clip(Rectangle<int> rect) {
+    const int x0 = std::max(rect.x, 0), y0 = std::max(rect.y, 0);
+    const int x1 = std::min(rect.x + rect.w, width), y1 = std::min(rect.y + rect.h, height);
+    clip_rect = Rectangle<int>(x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0));
+}
+
+void Framebuffer::clip_end() {
+    clip_rect = Rectangle<int>(0, 0, width, height);
+}
+
+bool Framebuffer::write_ppm(const char *path) const {
+    FILE *f = fopen(path, "wb");
+    if(f == NULL)
+        return false;
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    for(size_t i = 0; i < pixels.size(); i++) {
+        const uint16_t p = pixels[i];
+        fputc(((p >> 11) & 0x1f) << 3, f);
+        fputc(((p >> 5) & 0x3f) << 2, f);
+        fputc((p & 0x1f) << 3, f);
+    }
+    bool ok = !ferror(f);
+    return fclose(f) == 0 && ok;
+}
+
+} // namespace UI
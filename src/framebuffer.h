@@ -0,0 +1,39 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <cstdint>
+#include <vector>
+#include "ui.h"
+
+namespace UI {
+
+/* Software rasterizer over an RGB565 framebuffer, the format most SPI TFTs
+ * take. Everything is clipped to the screen and to the current clip
+ * rectangle. Text is blitted from the font atlases (see font.h), images
+ * straight from the runs of the sprite atlas (see sprite.h). */
+class Framebuffer {
+public:
+    Framebuffer() : clip_rect(0, 0, 0, 0) {}
+    void init(int w, int h);
+    static uint16_t pack(Color c) {
+        return ((c.r & 0xf8) << 8) | ((c.g & 0xfc) << 3) | (c.b >> 3);
+    }
+    void clear(Color color);
+    void fill_rectangle(Rectangle<int> rect, Color color);
+    void draw_rectangle(Rectangle<int> rect, Color color);
+    void draw_text(const char *msg, Vec2<int> pos, int font_size, Color color);
+    void draw_image(int sprite, Vec2<int> pos);
+    void clip(Rectangle<int> rect);
+    void clip_end();
+    bool write_ppm(const char *path) const;
+
+    int width = 0, height = 0;
+    std::vector<uint16_t> pixels;
+private:
+    void fill_span(int x0, int x1, int y, uint16_t color);
+    Rectangle<int> clip_rect;
+};
+
+} // namespace UI
+
+#endif
@@ -1,101 +1,150 @@
 #include <raylib.h>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include "ui.h"
 #include "backend.h"
+#include "demo.h"
+#include "font.h"
+#include "sprite.h"
+#include "trace.h"
+#include "pipeline.h"
 
 #define TFT_WIDTH 320
 #define TFT_HEIGHT 240
 
 UI::Context& ui = UI::Context::get();
 
-int page = 0;
-
-void menu() {
-    ui.begin_container("margin");
-    ui.h_space(20);
-    ui.end_container();
-    ui.begin_container("column1");
-    ui.label("button");
-    ui.nextline();
-    ui.label("int");
-    ui.nextline();
-    ui.label("float");
-    ui.nextline();
-    ui.label("listbox");
-    ui.nextline();
-    ui.label("textbox");
-    ui.end_container();
-    ui.begin_container("column2");
-    if(ui.button("page 1"))
-        page = 1;
-    ui.nextline();
-    static int x;
-    ui.input_number<int>(&x, 0, 100, 10);
-    ui.nextline();
-    static float f;
-    ui.input_number<float>(&f, 0, 100, 0.1);
-    ui.nextline();
-    static int selected = 0;
-    static std::vector<std::string> items = {"foo", "bar", "baz"};
-    ui.listbox(&selected, items);
-    ui.nextline();
-    static std::string text = "HELLO";
-    if(ui.input_text(text, 0))
-        printf("new text: %s\n", text.c_str());
-    ui.end_container();
+static void record_frame(UI::TraceWriter &recorder) {
+    UI::TraceFrame frame;
+    frame.time = ui.frame_time();
+    frame.keys = ui.key_state();
+    frame.hash = ui.frame_hash();
+    recorder.frame(frame);
 }
 
-void page1() {
-    int rows = 20, cols = 5;
-    char label[32];
-    for(int x = 0; x < cols; x++) {
-        ui.begin_container("column");
-        ui.set_next_widget_size(50, 20);
-        for(int y = 0; y < rows; y++) {
-            snprintf(label, sizeof(label), "Button %d", y * cols + x);
-            if(ui.button(label))
-                printf("%s clicked!\n", label);
-            ui.nextline();
-        }
-        ui.end_container();
+/* application thread of the pipelined mode : builds frames into the
+ * pipeline's draw lists, with the keys sampled by the render thread */
+static void build_frames(UI::FramePipeline *pipeline, std::atomic<uint8_t> *keys, UI::TraceWriter *recorder) {
+    UI::DrawList *list;
+    while((list = pipeline->begin_build()) != nullptr) {
+        ui.set_keys(*keys);
+        ui.set_draw_list(list);
+        ui.begin_frame();
+        demo_frame();
+        ui.end_frame();
+        record_frame(*recorder);
+        pipeline->end_build();
     }
-    ui.nextline();
-    static bool checked = false;
-    ui.checkbox(&checked);
-    if(checked) {
-        if(ui.button("hidden button")) {
-            printf("hidden button clicked!\n");
-            page = 0;
+}
+
+static void print_latency(const UI::LatencyStats &latency) {
+    if(latency.count > 0)
+        printf("input latency: %lu ms mean, %lu ms min, %lu ms max over %lu key presses\n",
+            latency.mean(), latency.min, latency.max, latency.count);
+}
+
+static void run_pipelined(UI::FramePipeline::BACKPRESSURE policy, UI::TraceWriter &recorder) {
+    UI::LatencyStats latency;
+    UI::FramePipeline pipeline(policy);
+    std::atomic<uint8_t> keys(read_keys());
+    std::thread app(build_frames, &pipeline, &keys, &recorder);
+    while (!WindowShouldClose()) { // raylib wants the window on the main thread, so it renders
+        const UI::DrawList *list = pipeline.begin_render();
+        if(list == nullptr) {
+            PollInputEvents();
+            keys = read_keys();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
         }
+        BeginDrawing();
+        ClearBackground(BLACK);
+        list->render();
+        const bool has_edge = list->has_input_edge;
+        const unsigned long edge_time = list->input_edge_time;
+        pipeline.end_render();
+        EndDrawing();
+        if(has_edge)
+            latency.add(ui_millis() - edge_time);
+        keys = read_keys();
     }
+    pipeline.stop();
+    app.join();
+    printf("frames: %lu built, %lu rendered, %lu dropped\n",
+        (unsigned long)pipeline.built, (unsigned long)pipeline.rendered, (unsigned long)pipeline.dropped);
+    print_latency(latency);
 }
 
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-r trace] [-p block|drop] [-a sprite_atlas] [-i]\n", name);
+    exit(1);
+}
 
-
-int main(void) {
+int main(int argc, char **argv) {
+    UI::TraceWriter recorder;
+    const char *trace_path = NULL;
+    bool immediate = false;
+    bool pipelined = false;
+    UI::FramePipeline::BACKPRESSURE policy = UI::FramePipeline::BLOCK;
+    for(int i = 1; i < argc; i++) {
+        if(i + 1 < argc && strcmp(argv[i], "-r") == 0) { // record the session, see trace.h
+            trace_path = argv[++i];
+        } else if(i + 1 < argc && strcmp(argv[i], "-a") == 0) { // see sprite.h
+            if(!UI::SpriteAtlas::get().open(argv[++i])) {
+                fprintf(stderr, "can't open sprite atlas %s\n", argv[i]);
+                return 1;
+            }
+        } else if(strcmp(argv[i], "-i") == 0) { // same-frame navigation
+            immediate = true;
+        } else if(i + 1 < argc && strcmp(argv[i], "-p") == 0) { // build and render on separate threads
+            pipelined = true;
+            ++i;
+            if(strcmp(argv[i], "drop") == 0)
+                policy = UI::FramePipeline::DROP;
+            else if(strcmp(argv[i], "block") != 0)
+                usage(argv[0]);
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if(trace_path != NULL) {
+        const uint8_t flags = UI::TRACE_HASHES | (immediate ? UI::TRACE_IMMEDIATE_NAVIGATION : 0);
+        if(!recorder.open(trace_path, flags, UI::Vec2<int>(TFT_WIDTH, TFT_HEIGHT))) {
+            fprintf(stderr, "can't write %s\n", trace_path);
+            return 1;
+        }
+        ui.enable_frame_hash(true);
+    }
+    ui.set_immediate_navigation(immediate);
     InitWindow(TFT_WIDTH, TFT_HEIGHT, "ui");
     SetTargetFPS(60);
     ui.init(TFT_WIDTH, TFT_HEIGHT);
-    while (!WindowShouldClose()) {
-        handle_keys(ui);
-        BeginDrawing();
-        ui.begin_frame();
-        ClearBackground(BLACK);
-        ui.begin_container("root");
-        if(!ui.is_keyboard_displayed()) {
-            switch(page) {
-                case 0:
-                    menu();
-                    break;
-                case 1:
-                    page1();
-                    break;
-            }
+    UI::Fonts::get().atlas(UI::Style().font_size); // bake the atlas before the first frame
+    if(pipelined) {
+        run_pipelined(policy, recorder);
+    } else {
+        while (!WindowShouldClose()) {
+            handle_keys(ui);
+            BeginDrawing();
+            ui.begin_frame();
+            ClearBackground(BLACK);
+            demo_frame();
+            ui.end_frame();
+            EndDrawing();
+            ui.present();
+            record_frame(recorder);
         }
-        ui.end_container();
-        ui.end_frame();
-        EndDrawing();
+        print_latency(ui.input_latency());
     }
+    const UI::SpriteAtlas &sprites = UI::SpriteAtlas::get();
+    if(sprites.count() > 0)
+        printf("sprites: %d, %zu bytes mapped, %zu resident, %zu bytes of textures\n",
+            sprites.count(), sprites.mapped_bytes(), sprites.resident_bytes(), sprite_texture_bytes());
     CloseWindow();
+    if(!recorder.close())
+        fprintf(stderr, "error writing the trace\n");
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,90 @@
+#include <thread>
+#include "pipeline.h"
+
+namespace UI {
+
+void FramePipeline::wait() {
+    std::this_thread::yield();
+}
+
+void FramePipeline::merge_edge(bool &has_edge, unsigned long &edge_time, bool other, unsigned long other_time) {
+    if(other && (!has_edge || other_time < edge_time)) {
+        has_edge = true;
+        edge_time = other_time;
+    }
+}
+
+DrawList *FramePipeline::begin_build() {
+    for(;;) {
+        if(stopped)
+            return nullptr;
+        int s = state.load();
+        if(rendering_of(s) != building)
+            break;
+        /* our list is on screen and the other one is waiting for the
+         * renderer : take the waiting one back, that frame is dropped */
+        if(policy == DROP && ready_of(s) == 1 - building
+            && state.compare_exchange_weak(s, make_state(-1, building))) {
+            building = 1 - building;
+            dropped++;
+            merge_edge(carried_edge, carried_edge_time, lists[building].has_input_edge, lists[building].input_edge_time);
+            break;
+        }
+        wait();
+    }
+    lists[building].clear();
+    return &lists[building];
+}
+
+void FramePipeline::end_build() {
+    DrawList &list = lists[building];
+    merge_edge(list.has_input_edge, list.input_edge_time, carried_edge, carried_edge_time);
+    carried_edge = false;
+    const bool has_edge = list.has_input_edge;
+    const unsigned long edge_time = list.input_edge_time;
+    for(;;) {
+        int s = state.load();
+        if(policy == BLOCK && ready_of(s) != -1) {
+            if(stopped)
+                return;
+            wait();
+            continue;
+        }
+        /* replacing a frame the renderer never picked up : take its edge.
+         * Redone on every attempt, the renderer may have taken it since. */
+        list.has_input_edge = has_edge;
+        list.input_edge_time = edge_time;
+        if(ready_of(s) == 1 - building)
+            merge_edge(list.has_input_edge, list.input_edge_time,
+                lists[1 - building].has_input_edge, lists[1 - building].input_edge_time);
+        if(state.compare_exchange_weak(s, make_state(building, rendering_of(s)))) {
+            if(ready_of(s) != -1)
+                dropped++;
+            break;
+        }
+    }
+    building = 1 - building;
+    built++;
+}
+
+const DrawList *FramePipeline::begin_render() {
+    for(;;) {
+        int s = state.load();
+        int ready = ready_of(s);
+        if(ready == -1)
+            return nullptr;
+        if(state.compare_exchange_weak(s, make_state(-1, ready)))
+            return &lists[ready];
+    }
+}
+
+void FramePipeline::end_render() {
+    for(;;) {
+        int s = state.load();
+        if(state.compare_exchange_weak(s, make_state(ready_of(s), -1)))
+            break;
+    }
+    rendered++;
+}
+
+} // namespace UI
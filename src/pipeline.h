@@ -0,0 +1,64 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <atomic>
+#include "ui.h"
+
+namespace UI {
+
+/* Pipelined frames ********************************************************* */
+/* Two draw lists shared by an application thread, which builds frame N+1 in
+ * one of them, and a render thread, which rasterizes and flushes frame N
+ * from the other. The hand-off is a single atomic word, no locks.
+ *
+ * Back-pressure decides what happens when the application is a frame ahead :
+ *  - BLOCK : the application waits for the renderer, every frame is shown
+ *  - DROP : the application never waits, a published frame the renderer
+ *           hasn't picked up yet is replaced by the newer one. The input
+ *           edge of a dropped frame (DrawList::has_input_edge) moves to the
+ *           next published one, so no key press goes unmeasured. */
+
+class FramePipeline {
+public:
+    enum BACKPRESSURE { BLOCK, DROP };
+
+    FramePipeline(BACKPRESSURE policy = BLOCK) : policy(policy) {}
+
+    /* application thread. begin_build() returns the list to build the next
+     * frame into (cleared), or nullptr once the pipeline is stopped */
+    DrawList *begin_build();
+    void end_build();
+
+    /* render thread. begin_render() returns the latest published frame, or
+     * nullptr if there is no new one */
+    const DrawList *begin_render();
+    void end_render();
+
+    void stop() { stopped = true; }
+    bool is_stopped() { return stopped; }
+
+    std::atomic<unsigned long> built{0}, rendered{0}, dropped{0};
+
+private:
+    /* state word : bits 0-1 hold the published list + 1 (0 : none),
+     * bits 2-3 the list being rendered + 1 */
+    static int make_state(int ready, int rendering) { return (ready + 1) | ((rendering + 1) << 2); }
+    static int ready_of(int state) { return (state & 3) - 1; }
+    static int rendering_of(int state) { return ((state >> 2) & 3) - 1; }
+    void wait();
+    /* keeps the earliest of the two input edges in has_edge / edge_time */
+    static void merge_edge(bool &has_edge, unsigned long &edge_time, bool other, unsigned long other_time);
+
+    const BACKPRESSURE policy;
+    DrawList lists[2];
+    std::atomic<int> state{make_state(-1, -1)};
+    std::atomic<bool> stopped{false};
+    int building = 0; // only touched by the application thread
+    /* edge of a frame taken back by begin_build, application thread */
+    bool carried_edge = false;
+    unsigned long carried_edge_time = 0;
+};
+
+} // namespace UI
+
+#endif
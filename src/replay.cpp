@@ -0,0 +1,217 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include "ui.h"
+#include "soft_backend.h"
+#include "demo.h"
+#include "font.h"
+#include "sprite.h"
+#include "trace.h"
+#include "pipeline.h"
+#include "stream.h"
+
+/* Replays an input trace (see trace.h) on the software backend, with no
+ * window and a virtual clock, so a recorded session runs the same way every
+ * time. Frames are checked against the recorded hashes when the trace has
+ * them, and the time spent on each frame is reported.
+ *
+ * -d simulates a slow display flush (SPI transfer...) after each frame, -p
+ * renders and flushes on a second thread (see pipeline.h), -s sends the frames
+ * to a display server instead of rasterizing them (see stream.h). The screen
+ * size and Context::set_immediate_navigation come from the trace, -i turns
+ * the latter on for a trace recorded without it, as long as there are no
+ * hashes to compare. With the virtual clock, the input latency is counted in
+ * whole frames of the trace. */
+
+typedef std::chrono::steady_clock Clock;
+
+UI::Context& ui = UI::Context::get();
+
+static long flush_us = 0;
+static UI::LatencyStats render_latency; // pipelined mode, owned by the render thread
+
+static void flush(void) {
+    if(flush_us > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(flush_us));
+}
+
+static void render_frames(UI::FramePipeline *pipeline) {
+    UI::Framebuffer &fb = soft_framebuffer();
+    for(;;) {
+        bool stopped = pipeline->is_stopped();
+        const UI::DrawList *list = pipeline->begin_render();
+        if(list == nullptr) {
+            if(stopped)
+                break;
+            std::this_thread::yield();
+            continue;
+        }
+        fb.clear(UI::Color::black());
+        list->render();
+        const bool has_edge = list->has_input_edge;
+        const unsigned long edge_time = list->input_edge_time;
+        pipeline->end_render();
+        flush();
+        if(has_edge)
+            render_latency.add(ui_millis() - edge_time);
+    }
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s trace [-o screenshot.ppm] [-r rehashed_trace] [-d flush_us] [-p block|drop] [-s socket] [-a sprite_atlas] [-i]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *trace_path = NULL;
+    const char *screenshot = NULL;
+    const char *rehash_path = NULL;
+    const char *socket_path = NULL;
+    const char *sprite_path = NULL;
+    bool immediate = false;
+    bool pipelined = false;
+    UI::FramePipeline::BACKPRESSURE policy = UI::FramePipeline::BLOCK;
+    for(int i = 1; i < argc; i++) {
+        if(i + 1 < argc && strcmp(argv[i], "-o") == 0) {
+            screenshot = argv[++i];
+        } else if(i + 1 < argc && strcmp(argv[i], "-r") == 0) {
+            rehash_path = argv[++i];
+        } else if(strcmp(argv[i], "-i") == 0) {
+            immediate = true;
+        } else if(i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+            socket_path = argv[++i];
+        } else if(i + 1 < argc && strcmp(argv[i], "-a") == 0) {
+            sprite_path = argv[++i];
+        } else if(i + 1 < argc && strcmp(argv[i], "-d") == 0) {
+            flush_us = atol(argv[++i]);
+        } else if(i + 1 < argc && strcmp(argv[i], "-p") == 0) {
+            pipelined = true;
+            ++i;
+            if(strcmp(argv[i], "drop") == 0)
+                policy = UI::FramePipeline::DROP;
+            else if(strcmp(argv[i], "block") != 0)
+                usage(argv[0]);
+        } else if(argv[i][0] != '-' && trace_path == NULL) {
+            trace_path = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if(trace_path == NULL || (socket_path != NULL && pipelined))
+        usage(argv[0]);
+
+    UI::TraceReader reader;
+    if(!reader.open(trace_path)) {
+        fprintf(stderr, "can't read trace %s\n", trace_path);
+        return 1;
+    }
+    if(immediate && !reader.has_immediate_navigation() && reader.has_hashes()) {
+        fprintf(stderr, "%s was recorded without -i, its frame hashes would not match\n", trace_path);
+        return 1;
+    }
+    immediate = immediate || reader.has_immediate_navigation();
+    ui.set_immediate_navigation(immediate);
+    const UI::Vec2<int> screen_size = reader.screen_size();
+    UI::TraceWriter rehashed;
+    const uint8_t rehash_flags = UI::TRACE_HASHES | (immediate ? UI::TRACE_IMMEDIATE_NAVIGATION : 0);
+    if(rehash_path != NULL && !rehashed.open(rehash_path, rehash_flags, screen_size)) {
+        fprintf(stderr, "can't write %s\n", rehash_path);
+        return 1;
+    }
+
+    UI::Framebuffer &fb = soft_framebuffer();
+    fb.init(screen_size.x, screen_size.y);
+    UI::Fonts::get().atlas(UI::Style().font_size);
+    if(sprite_path != NULL && !UI::SpriteAtlas::get().open(sprite_path)) {
+        fprintf(stderr, "can't open sprite atlas %s\n", sprite_path);
+        return 1;
+    }
+    soft_set_time(0);
+    ui.init(screen_size.x, screen_size.y);
+    ui.enable_frame_hash(true);
+
+    UI::DrawListStream stream;
+    UI::DrawList streamed;
+    if(socket_path != NULL && !stream.connect(socket_path)) {
+        fprintf(stderr, "can't connect to %s\n", socket_path);
+        return 1;
+    }
+
+    UI::FramePipeline pipeline(policy);
+    std::thread renderer;
+    if(pipelined)
+        renderer = std::thread(render_frames, &pipeline);
+
+    unsigned long frames = 0, mismatches = 0;
+    long long total_us = 0, max_us = 0;
+    Clock::time_point session_start = Clock::now();
+    UI::TraceFrame f;
+    while(reader.next(f)) {
+        Clock::time_point start = Clock::now();
+        soft_set_time(f.time);
+        ui.set_keys(f.keys);
+        if(pipelined) {
+            ui.set_draw_list(pipeline.begin_build());
+        } else if(socket_path != NULL) {
+            streamed.clear();
+            ui.set_draw_list(&streamed);
+        } else {
+            fb.clear(UI::Color::black());
+        }
+        ui.begin_frame();
+        demo_frame();
+        ui.end_frame();
+        if(pipelined)
+            pipeline.end_build();
+        else if(socket_path != NULL && !stream.send(streamed))
+            fprintf(stderr, "frame %lu: send failed\n", frames);
+        else
+            flush();
+        if(!pipelined)
+            ui.present();
+        long long us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+        total_us += us;
+        if(us > max_us)
+            max_us = us;
+        if(reader.has_hashes() && ui.frame_hash() != f.hash) {
+            if(mismatches == 0)
+                fprintf(stderr, "frame %lu: hash %08x, recorded %08x\n", frames, ui.frame_hash(), f.hash);
+            mismatches++;
+        }
+        f.hash = ui.frame_hash();
+        rehashed.frame(f);
+        frames++;
+    }
+    if(pipelined) {
+        pipeline.stop();
+        renderer.join();
+    }
+    long long session_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - session_start).count();
+    if(!rehashed.close())
+        fprintf(stderr, "error writing %s\n", rehash_path);
+
+    printf("frames: %lu\n", frames);
+    if(frames > 0) {
+        printf("frame time: %lld us mean, %lld us max\n", total_us / (long long)frames, max_us);
+        printf("throughput: %.1f fps\n", session_us > 0 ? frames * 1e6 / session_us : 0.0);
+    }
+    if(pipelined)
+        printf("pipeline: %lu built, %lu rendered, %lu dropped\n",
+            (unsigned long)pipeline.built, (unsigned long)pipeline.rendered, (unsigned long)pipeline.dropped);
+    const UI::LatencyStats &latency = pipelined ? render_latency : ui.input_latency();
+    if(latency.count > 0)
+        printf("input latency: %lu ms mean, %lu ms max over %lu key presses\n", latency.mean(), latency.max, latency.count);
+    if(stream.frames > 0)
+        printf("stream: %lu bytes per frame mean, %lu bytes per keyframe\n", stream.bytes / stream.frames,
+            stream.keyframe_bytes / ((stream.frames + stream.keyframe_interval - 1) / stream.keyframe_interval));
+    const UI::SpriteAtlas &sprites = UI::SpriteAtlas::get();
+    if(sprites.count() > 0)
+        printf("sprites: %d, %zu bytes mapped, %zu resident\n", sprites.count(), sprites.mapped_bytes(), sprites.resident_bytes());
+    if(reader.has_hashes())
+        printf("hash mismatches: %lu\n", mismatches);
+    if(screenshot != NULL && !fb.write_ppm(screenshot))
+        fprintf(stderr, "can't write %s\n", screenshot);
+    return mismatches == 0 ? 0 : 2;
+}
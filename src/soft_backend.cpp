@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <atomic>
+#include <chrono>
+#include "soft_backend.h"
+#include "font.h"
+#include "sprite.h"
+
+static UI::Framebuffer framebuffer;
+static std::atomic<bool> virtual_clock(false);
+static std::atomic<unsigned long> virtual_time(0); // read by the render thread of a pipeline
+
+UI::Framebuffer &soft_framebuffer(void) {
+    return framebuffer;
+}
+
+void ui_draw_rectangle(UI::Rectangle<int> rect, UI::Color color) {
+    framebuffer.draw_rectangle(rect, color);
+}
+
+void ui_fill_rectangle(UI::Rectangle<int> rect, UI::Color color) {
+    framebuffer.fill_rectangle(rect, color);
+}
+
+void ui_draw_text(const char *msg, UI::Vec2<int> pos, int font_size, UI::Color color) {
+    framebuffer.draw_text(msg, pos, font_size, color);
+}
+
+int ui_get_text_width(const char *text, int font_size) {
+    return UI::Fonts::get().text_width(text, font_size);
+}
+
+void ui_draw_image(int image, UI::Vec2<int> pos) {
+    framebuffer.draw_image(image, pos);
+}
+
+UI::Vec2<int> ui_get_image_size(int image) {
+    return UI::SpriteAtlas::get().size(image);
+}
+
+void ui_clip(UI::Rectangle<int> rect) {
+    framebuffer.clip(rect);
+}
+
+void ui_clip_end(void) {
+    framebuffer.clip_end();
+}
+
+void soft_set_time(unsigned long ms) {
+    virtual_clock = true;
+    virtual_time = ms;
+}
+
+unsigned long ui_millis(void) {
+    if(virtual_clock)
+        return virtual_time;
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ui_error(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    abort();
+}
@@ -0,0 +1,5 @@
+#include "ui.h"
+#include "framebuffer.h"
+UI::Framebuffer &soft_framebuffer(void);
+/* switches ui_millis() to a virtual clock, which only moves when told to */
+void soft_set_time(unsigned long ms);
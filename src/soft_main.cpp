@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "ui.h"
+#include "soft_backend.h"
+#include "demo.h"
+#include "font.h"
+#include "sprite.h"
+
+#define TFT_WIDTH 320
+#define TFT_HEIGHT 240
+
+/* Headless run of the demo on the software backend : renders a number of
+ * frames and dumps the last one as a ppm image. */
+
+UI::Context& ui = UI::Context::get();
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-n frames] [-o screenshot.ppm] [-f font_atlas] [-a sprite_atlas]\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int frames = 1;
+    const char *screenshot = "screenshot.ppm";
+    const char *font_path = NULL;
+    const char *sprite_path = NULL;
+    for(int i = 1; i < argc; i++) {
+        if(i + 1 < argc && strcmp(argv[i], "-n") == 0)
+            frames = atoi(argv[++i]);
+        else if(i + 1 < argc && strcmp(argv[i], "-o") == 0)
+            screenshot = argv[++i];
+        else if(i + 1 < argc && strcmp(argv[i], "-f") == 0)
+            font_path = argv[++i];
+        else if(i + 1 < argc && strcmp(argv[i], "-a") == 0)
+            sprite_path = argv[++i];
+        else
+            usage(argv[0]);
+    }
+    UI::Fonts &fonts = UI::Fonts::get();
+    const int font_size = UI::Style().font_size;
+    if(font_path != NULL && !fonts.load(font_path)) {
+        // no prebuilt atlas yet, bake it and save it for the next runs
+        if(!fonts.atlas(font_size).save(font_path))
+            fprintf(stderr, "can't write %s\n", font_path);
+    }
+    fonts.atlas(font_size);
+    if(sprite_path != NULL && !UI::SpriteAtlas::get().open(sprite_path)) {
+        fprintf(stderr, "can't open sprite atlas %s\n", sprite_path);
+        return 1;
+    }
+
+    UI::Framebuffer &fb = soft_framebuffer();
+    fb.init(TFT_WIDTH, TFT_HEIGHT);
+    ui.init(TFT_WIDTH, TFT_HEIGHT);
+    for(int i = 0; i < frames; i++) {
+        ui.begin_frame();
+        fb.clear(UI::Color::black());
+        demo_frame();
+        ui.end_frame();
+    }
+    printf("glyph runs: %lu hits, %lu misses\n", fonts.hits, fonts.misses);
+    const UI::SpriteAtlas &sprites = UI::SpriteAtlas::get();
+    if(sprites.count() > 0)
+        printf("sprites: %d, %zu bytes mapped, %zu resident\n", sprites.count(), sprites.mapped_bytes(), sprites.resident_bytes());
+    if(!fb.write_ppm(screenshot)) {
+        fprintf(stderr, "can't write %s\n", screenshot);
+        return 1;
+    }
+    return 0;
+}
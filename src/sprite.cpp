@@ -0,0 +1,102 @@
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sprite.h"
+
+namespace UI {
+
+static const char sprite_magic[4] = {'U', 'I', 'S', 'P'};
+const uint8_t SpriteAtlas::version;
+const size_t SpriteAtlas::header_size;
+const size_t SpriteAtlas::entry_size;
+const size_t SpriteAtlas::name_size;
+
+static uint32_t get_le(const uint8_t *p, int bytes) {
+    uint32_t v = 0;
+    for(int i = 0; i < bytes; i++)
+        v |= (uint32_t)p[i] << (8 * i);
+    return v;
+}
+
+bool SpriteAtlas::open(const char *path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    void *p = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && (size_t)st.st_size >= header_size)
+        p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps the file
+    if(p == MAP_FAILED)
+        return false;
+    data = (const uint8_t*)p;
+    data_size = st.st_size;
+    palette_size = get_le(data + 6, 2);
+    sprite_count = get_le(data + 8, 2);
+    palette_end = header_size + 4 * palette_size;
+    if(memcmp(data, sprite_magic, sizeof(sprite_magic)) != 0 || data[4] != version
+        || palette_size > 256 || palette_end + sprite_count * entry_size > data_size) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SpriteAtlas::close() {
+    if(data != nullptr)
+        munmap((void*)data, data_size);
+    data = nullptr;
+    data_size = palette_end = 0;
+    palette_size = sprite_count = 0;
+}
+
+int SpriteAtlas::find(const char *name) const {
+    for(int i = 0; i < sprite_count; i++)
+        if(strncmp((const char*)entry(i), name, name_size) == 0)
+            return i;
+    return -1;
+}
+
+Vec2<int> SpriteAtlas::size(int sprite) const {
+    if(sprite < 0 || sprite >= sprite_count)
+        return Vec2<int>(0, 0);
+    const uint8_t *e = entry(sprite);
+    return Vec2<int>(get_le(e + name_size, 2), get_le(e + name_size + 2, 2));
+}
+
+const uint8_t *SpriteAtlas::row(int sprite, int y) const {
+    if(sprite < 0 || sprite >= sprite_count || y < 0 || y >= size(sprite).y)
+        return nullptr;
+    const uint32_t table = get_le(entry(sprite) + name_size + 4, 4);
+    if(table + 4 * (size_t)(y + 1) > data_size)
+        return nullptr;
+    const uint32_t offset = get_le(data + table + 4 * y, 4);
+    return offset < data_size ? data + offset : nullptr;
+}
+
+Color SpriteAtlas::color(uint8_t index) const {
+    if(index >= palette_size)
+        return Color(0, 0, 0, 0);
+    const uint8_t *c = data + header_size + 4 * index;
+    return Color(c[0], c[1], c[2], c[3]);
+}
+
+size_t SpriteAtlas::resident_bytes() const {
+    if(data == nullptr)
+        return 0;
+    const size_t page = sysconf(_SC_PAGESIZE);
+    std::vector<unsigned char> pages((data_size + page - 1) / page);
+    if(mincore((void*)data, data_size, pages.data()) != 0)
+        return 0;
+    size_t resident = 0;
+    for(size_t i = 0; i < pages.size(); i++)
+        if(pages[i] & 1)
+            resident += std::min(page, data_size - i * page);
+    return resident;
+}
+
+} // namespace UI
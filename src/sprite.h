@@ -0,0 +1,65 @@
+#ifndef SPRITE_H
+#define SPRITE_H
+
+#include <cstdint>
+#include <cstddef>
+#include "ui.h"
+
+namespace UI {
+
+/* Sprite atlas ************************************************************* */
+/* Images packed by ui_sprite_pack into a single file, which is memory-mapped :
+ * opening it reads the header and nothing else, and the pages of sprites that
+ * are never drawn are never read.
+ *
+ * File layout (little endian) : "UISP", version, a zero byte, palette size
+ * (u16, at most 256), sprite count (u16), the palette (RGBA), then one 24 byte
+ * entry per sprite : name (16 bytes, nul padded), width and height (u16), and
+ * the file offset of its row table (u32). A row table has one u32 file offset
+ * per row, pointing to the row's runs : pairs of length (1..255) and palette
+ * index, covering the width. Palette colors with a zero alpha are
+ * transparent, other alphas are drawn opaque.
+ *
+ * Sprites are identified by their index in the file, find() looks a name up.
+ * The atlas is shared by all threads and read-only once opened. */
+class SpriteAtlas {
+public:
+    static SpriteAtlas &get() {
+        static SpriteAtlas instance;
+        return instance;
+    }
+    SpriteAtlas(SpriteAtlas const&) = delete;
+    void operator=(SpriteAtlas const&) = delete;
+    ~SpriteAtlas() { close(); }
+
+    static const uint8_t version = 1;
+    static const size_t header_size = 10, entry_size = 24, name_size = 16;
+
+    bool open(const char *path);
+    void close();
+    int count() const { return sprite_count; }
+    /* -1 if there is no such sprite (or no atlas) */
+    int find(const char *name) const;
+    /* (0, 0) for an unknown sprite */
+    Vec2<int> size(int sprite) const;
+    /* the runs of a row, nullptr if the file is damaged there. Runs stop at
+     * the end of the mapping, see end(). */
+    const uint8_t *row(int sprite, int y) const;
+    const uint8_t *end() const { return data + data_size; }
+    Color color(uint8_t index) const;
+
+    size_t mapped_bytes() const { return data_size; }
+    /* bytes of the mapping actually in memory */
+    size_t resident_bytes() const;
+
+private:
+    SpriteAtlas() {}
+    const uint8_t *entry(int sprite) const { return data + palette_end + sprite * entry_size; }
+    const uint8_t *data = nullptr;
+    size_t data_size = 0, palette_end = 0;
+    int palette_size = 0, sprite_count = 0;
+};
+
+} // namespace UI
+
+#endif
@@ -0,0 +1,167 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <vector>
+#include "sprite.h"
+
+/* Packs ppm images (P3 or P6, maxval 255) into a sprite atlas (see sprite.h).
+ * A sprite is named after its file, without the directory and extension.
+ * Magenta (255, 0, 255) pixels are transparent. The images can't use more
+ * than 255 other colors between them. */
+
+class Image {
+public:
+    std::string name;
+    int width = 0, height = 0;
+    std::vector<UI::Color> pixels;
+};
+
+static bool read_token(FILE *f, int *value) {
+    int c = fgetc(f);
+    for(;;) {
+        while(c != EOF && isspace(c))
+            c = fgetc(f);
+        if(c != '#')
+            break;
+        while(c != EOF && c != '\n')
+            c = fgetc(f);
+    }
+    if(c == EOF || !isdigit(c))
+        return false;
+    *value = 0;
+    while(c != EOF && isdigit(c)) {
+        *value = *value * 10 + c - '0';
+        c = fgetc(f);
+    }
+    return true; // the whitespace after the number is consumed
+}
+
+static bool read_ppm(const char *path, Image &image) {
+    FILE *f = fopen(path, "rb");
+    if(f == NULL)
+        return false;
+    char magic[2];
+    int maxval;
+    bool ok = fread(magic, 1, 2, f) == 2 && magic[0] == 'P' && (magic[1] == '3' || magic[1] == '6')
+        && read_token(f, &image.width) && read_token(f, &image.height) && read_token(f, &maxval)
+        && maxval == 255 && image.width > 0 && image.height > 0 && image.width < 65536 && image.height < 65536;
+    image.pixels.resize(ok ? image.width * image.height : 0);
+    for(size_t i = 0; ok && i < image.pixels.size(); i++) {
+        int rgb[3];
+        for(int k = 0; ok && k < 3; k++) {
+            if(magic[1] == '6')
+                ok = (rgb[k] = fgetc(f)) != EOF;
+            else
+                ok = read_token(f, &rgb[k]) && rgb[k] <= 255;
+        }
+        const bool transparent = rgb[0] == 255 && rgb[1] == 0 && rgb[2] == 255;
+        image.pixels[i] = transparent ? UI::Color(0, 0, 0, 0) : UI::Color(rgb[0], rgb[1], rgb[2], 255);
+    }
+    fclose(f);
+    return ok;
+}
+
+static std::string sprite_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    std::string name = slash ? slash + 1 : path;
+    return name.substr(0, name.rfind('.'));
+}
+
+static void put_le(std::vector<uint8_t> &out, uint32_t v, int bytes) {
+    for(int i = 0; i < bytes; i++)
+        out.push_back((v >> (8 * i)) & 0xff);
+}
+
+static void patch_le(std::vector<uint8_t> &out, size_t at, uint32_t v, int bytes) {
+    for(int i = 0; i < bytes; i++)
+        out[at + i] = (v >> (8 * i)) & 0xff;
+}
+
+static int palette_index(std::vector<UI::Color> &palette, UI::Color c) {
+    for(size_t i = 0; i < palette.size(); i++)
+        if(palette[i].r == c.r && palette[i].g == c.g && palette[i].b == c.b && palette[i].a == c.a)
+            return i;
+    palette.push_back(c);
+    return palette.size() - 1;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s atlas image.ppm...\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    if(argc < 3)
+        usage(argv[0]);
+    std::vector<Image> images(argc - 2);
+    std::vector<UI::Color> palette(1, UI::Color(0, 0, 0, 0)); // 0 is transparent
+    for(int i = 2; i < argc; i++) {
+        Image &image = images[i - 2];
+        if(!read_ppm(argv[i], image)) {
+            fprintf(stderr, "can't read %s\n", argv[i]);
+            return 1;
+        }
+        image.name = sprite_name(argv[i]);
+        if(image.name.size() >= UI::SpriteAtlas::name_size) {
+            fprintf(stderr, "%s: name longer than %d characters\n", argv[i], (int)UI::SpriteAtlas::name_size - 1);
+            return 1;
+        }
+        for(size_t p = 0; p < image.pixels.size(); p++)
+            palette_index(palette, image.pixels[p]);
+        if(palette.size() > 256) {
+            fprintf(stderr, "more than 255 colors\n");
+            return 1;
+        }
+    }
+
+    std::vector<uint8_t> out;
+    out.insert(out.end(), {'U', 'I', 'S', 'P', UI::SpriteAtlas::version, 0});
+    put_le(out, palette.size(), 2);
+    put_le(out, images.size(), 2);
+    for(size_t i = 0; i < palette.size(); i++)
+        out.insert(out.end(), {palette[i].r, palette[i].g, palette[i].b, palette[i].a});
+    const size_t table = out.size();
+    out.resize(table + images.size() * UI::SpriteAtlas::entry_size, 0);
+    size_t raw = 0;
+    for(size_t i = 0; i < images.size(); i++) {
+        const Image &image = images[i];
+        const size_t entry = table + i * UI::SpriteAtlas::entry_size;
+        memcpy(&out[entry], image.name.c_str(), image.name.size());
+        patch_le(out, entry + UI::SpriteAtlas::name_size, image.width, 2);
+        patch_le(out, entry + UI::SpriteAtlas::name_size + 2, image.height, 2);
+        patch_le(out, entry + UI::SpriteAtlas::name_size + 4, out.size(), 4);
+        const size_t rows = out.size();
+        out.resize(rows + 4 * image.height, 0);
+        for(int y = 0; y < image.height; y++) {
+            patch_le(out, rows + 4 * y, out.size(), 4);
+            const UI::Color *row = &image.pixels[y * image.width];
+            for(int x = 0; x < image.width;) {
+                const int index = palette_index(palette, row[x]);
+                int n = 1;
+                while(x + n < image.width && n < 255 && palette_index(palette, row[x + n]) == index)
+                    n++;
+                out.push_back(n);
+                out.push_back(index);
+                x += n;
+            }
+        }
+        raw += image.width * image.height * 4;
+    }
+
+    FILE *f = fopen(argv[1], "wb");
+    if(f == NULL) {
+        fprintf(stderr, "can't write %s\n", argv[1]);
+        return 1;
+    }
+    fwrite(out.data(), 1, out.size(), f);
+    bool ok = !ferror(f);
+    ok = fclose(f) == 0 && ok;
+    if(!ok) {
+        fprintf(stderr, "can't write %s\n", argv[1]);
+        return 1;
+    }
+    printf("%zu sprites, %zu colors : %zu bytes (%zu as RGBA)\n", images.size(), palette.size(), out.size(), raw);
+    return 0;
+}
@@ -0,0 +1,305 @@
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "stream.h"
+
+namespace UI {
+
+static const uint8_t stream_magic[2] = {'U', 'D'};
+const size_t StreamHeader::size;
+const uint8_t StreamHeader::version;
+const uint32_t StreamHeader::max_payload_size;
+
+uint64_t stream_clock(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Encoding ***************************************************************** */
+
+static void put_le(std::vector<uint8_t> &out, uint64_t v, int bytes) {
+    for(int i = 0; i < bytes; i++)
+        out.push_back((v >> (8 * i)) & 0xff);
+}
+
+static void patch_le(uint8_t *out, uint64_t v, int bytes) {
+    for(int i = 0; i < bytes; i++)
+        out[i] = (v >> (8 * i)) & 0xff;
+}
+
+static void put_varint(std::vector<uint8_t> &out, uint32_t v) {
+    while(v >= 0x80) {
+        out.push_back((v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(v);
+}
+
+static void put_zigzag(std::vector<uint8_t> &out, int32_t v) {
+    put_varint(out, ((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+}
+
+static bool same_color(Color a, Color b) {
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static bool same_rect(Rectangle<int> a, Rectangle<int> b) {
+    return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+/* the command at the same position in the previous frame, or an empty one */
+static const DrawCommand &reference(const DrawList *previous, size_t i, const char **text) {
+    static const DrawCommand none = DrawCommand();
+    *text = "";
+    if(previous == nullptr || i >= previous->commands.size())
+        return none;
+    const DrawCommand &cmd = previous->commands[i];
+    if(cmd.op == DRAW_TEXT)
+        *text = &previous->text[cmd.text];
+    return cmd;
+}
+
+const std::vector<uint8_t> &DrawListEncoder::encode(const DrawList &list, uint32_t frame, uint64_t timestamp, bool keyframe) {
+    packet.clear();
+    packet.insert(packet.end(), stream_magic, stream_magic + sizeof(stream_magic));
+    packet.push_back(StreamHeader::version);
+    packet.push_back(keyframe ? STREAM_KEYFRAME : 0);
+    put_le(packet, 0, 4); // payload size, patched below
+    put_le(packet, frame, 4);
+    put_le(packet, timestamp, 8);
+
+    const DrawList *prev = keyframe ? nullptr : &previous;
+    put_varint(packet, list.commands.size());
+    size_t i = 0;
+    while(i < list.commands.size()) {
+        size_t run = 0;
+        for(; i + run < list.commands.size(); run++) {
+            const DrawCommand &cmd = list.commands[i + run];
+            const char *ref_text;
+            const DrawCommand &ref = reference(prev, i + run, &ref_text);
+            if(prev == nullptr || i + run >= prev->commands.size() || cmd.op != ref.op
+                || !same_rect(cmd.rect, ref.rect) || !same_color(cmd.color, ref.color)
+                || (cmd.op == DRAW_TEXT && strcmp(&list.text[cmd.text], ref_text) != 0))
+                break;
+        }
+        if(run > 0) {
+            packet.push_back(STREAM_COPY);
+            put_varint(packet, run);
+            i += run;
+            continue;
+        }
+        const DrawCommand &cmd = list.commands[i];
+        const char *ref_text;
+        const DrawCommand &ref = reference(prev, i, &ref_text);
+        const char *text = cmd.op == DRAW_TEXT ? &list.text[cmd.text] : "";
+        const bool keep_color = same_color(cmd.color, ref.color);
+        const bool keep_text = strcmp(text, ref_text) == 0;
+        packet.push_back(cmd.op | (keep_color ? STREAM_SAME_COLOR : 0) | (keep_text ? STREAM_SAME_TEXT : 0));
+        if(cmd.op != CLIP_END) {
+            put_zigzag(packet, cmd.rect.x - ref.rect.x);
+            put_zigzag(packet, cmd.rect.y - ref.rect.y);
+            put_zigzag(packet, cmd.rect.w - ref.rect.w);
+            put_zigzag(packet, cmd.rect.h - ref.rect.h);
+            if(!keep_color) {
+                packet.push_back(cmd.color.r);
+                packet.push_back(cmd.color.g);
+                packet.push_back(cmd.color.b);
+                packet.push_back(cmd.color.a);
+            }
+            if(cmd.op == DRAW_TEXT && !keep_text) {
+                size_t len = strlen(text);
+                put_varint(packet, len);
+                packet.insert(packet.end(), text, text + len);
+            }
+        }
+        i++;
+    }
+    patch_le(&packet[4], packet.size() - StreamHeader::size, 4);
+    previous = list;
+    return packet;
+}
+
+/* Decoding ***************************************************************** */
+
+bool StreamHeader::parse(const uint8_t *data) {
+    if(memcmp(data, stream_magic, sizeof(stream_magic)) != 0 || data[2] != version)
+        return false;
+    flags = data[3];
+    payload_size = 0;
+    frame = 0;
+    timestamp = 0;
+    for(int i = 0; i < 4; i++) {
+        payload_size |= (uint32_t)data[4 + i] << (8 * i);
+        frame |= (uint32_t)data[8 + i] << (8 * i);
+    }
+    for(int i = 0; i < 8; i++)
+        timestamp |= (uint64_t)data[12 + i] << (8 * i);
+    return payload_size <= max_payload_size;
+}
+
+class Reader {
+public:
+    Reader(const uint8_t *p, const uint8_t *end) : p(p), end(end) {}
+    bool byte(uint8_t &v) {
+        if(p >= end) return false;
+        v = *p++;
+        return true;
+    }
+    bool varint(uint32_t &v) {
+        v = 0;
+        for(int shift = 0; shift < 35; shift += 7) {
+            uint8_t b;
+            if(!byte(b)) return false;
+            v |= (uint32_t)(b & 0x7f) << shift;
+            if(!(b & 0x80)) return true;
+        }
+        return false;
+    }
+    bool zigzag(int32_t &v) {
+        uint32_t u;
+        if(!varint(u)) return false;
+        v = (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+        return true;
+    }
+    bool bytes(const uint8_t *&data, size_t size) {
+        if((size_t)(end - p) < size) return false;
+        data = p;
+        p += size;
+        return true;
+    }
+    const uint8_t *p, *end;
+};
+
+const DrawList *DrawListDecoder::decode(const StreamHeader &header, const uint8_t *payload) {
+    const bool keyframe = header.flags & STREAM_KEYFRAME;
+    if(!keyframe && !has_previous)
+        return nullptr;
+    // a frame lost in the middle leaves the next deltas without their base
+    has_previous = decode_payload(keyframe ? nullptr : &previous, payload, header.payload_size)
+        && check_font_sizes();
+    if(!has_previous)
+        return nullptr;
+    std::swap(previous, current);
+    return &previous;
+}
+
+bool DrawListDecoder::decode_payload(const DrawList *prev, const uint8_t *payload, size_t size) {
+    Reader in(payload, payload + size);
+    uint32_t count;
+    if(!in.varint(count))
+        return false;
+    current.clear();
+    std::string text; // scratch for the nul terminator
+    while(current.commands.size() < count) {
+        uint8_t tag;
+        if(!in.byte(tag))
+            return false;
+        const size_t i = current.commands.size();
+        if(tag == STREAM_COPY) {
+            uint32_t run;
+            if(!in.varint(run) || prev == nullptr || i + run > prev->commands.size() || i + run > count)
+                return false;
+            for(size_t j = i; j < i + run; j++) {
+                const DrawCommand &cmd = prev->commands[j];
+                current.push((DRAW_OP)cmd.op, cmd.rect, cmd.color, cmd.op == DRAW_TEXT ? &prev->text[cmd.text] : nullptr);
+            }
+            continue;
+        }
+        const uint8_t op = tag & STREAM_OP_MASK;
+        if(op > DRAW_IMAGE)
+            return false;
+        const char *ref_text;
+        const DrawCommand &ref = reference(prev, i, &ref_text);
+        Rectangle<int> rect(0, 0, 0, 0);
+        Color color = ref.color;
+        text = ref_text;
+        if(op != CLIP_END) {
+            int32_t d[4];
+            for(int k = 0; k < 4; k++)
+                if(!in.zigzag(d[k]))
+                    return false;
+            rect = Rectangle<int>(ref.rect.x + d[0], ref.rect.y + d[1], ref.rect.w + d[2], ref.rect.h + d[3]);
+            if(!(tag & STREAM_SAME_COLOR)) {
+                if(!in.byte(color.r) || !in.byte(color.g) || !in.byte(color.b) || !in.byte(color.a))
+                    return false;
+            }
+            if(op == DRAW_TEXT && !(tag & STREAM_SAME_TEXT)) {
+                uint32_t len;
+                const uint8_t *data;
+                if(!in.varint(len) || !in.bytes(data, len))
+                    return false;
+                text.assign((const char*)data, len);
+            }
+        }
+        current.push((DRAW_OP)op, rect, color, op == DRAW_TEXT ? text.c_str() : nullptr);
+    }
+    return true;
+}
+
+bool DrawListDecoder::check_font_sizes() {
+    int sizes[Fonts::max_atlases];
+    int count = font_size_count;
+    std::copy(font_sizes, font_sizes + count, sizes);
+    for(const DrawCommand &cmd : current.commands) {
+        if(cmd.op != DRAW_TEXT || std::find(sizes, sizes + count, cmd.rect.w) != sizes + count)
+            continue;
+        if(!FontAtlas::can_bake(cmd.rect.w) || count == Fonts::max_atlases)
+            return false;
+        sizes[count++] = cmd.rect.w;
+    }
+    std::copy(sizes, sizes + count, font_sizes);
+    font_size_count = count;
+    return true;
+}
+
+/* Transport **************************************************************** */
+
+bool DrawListStream::connect(const char *path) {
+    close();
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr.sun_path))
+        return false;
+    strcpy(addr.sun_path, path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+        return false;
+    if(::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        close();
+        return false;
+    }
+    frames = bytes = keyframe_bytes = 0;
+    return true;
+}
+
+bool DrawListStream::send(const DrawList &list) {
+    if(fd < 0)
+        return false;
+    const bool keyframe = keyframe_interval <= 1 || frames % keyframe_interval == 0;
+    const std::vector<uint8_t> &packet = encoder.encode(list, frames, stream_clock(), keyframe);
+    size_t sent = 0;
+    while(sent < packet.size()) {
+        ssize_t n = ::send(fd, &packet[sent], packet.size() - sent, MSG_NOSIGNAL);
+        if(n <= 0) {
+            close();
+            return false;
+        }
+        sent += n;
+    }
+    frames++;
+    bytes += packet.size();
+    if(keyframe)
+        keyframe_bytes += packet.size();
+    return true;
+}
+
+void DrawListStream::close() {
+    if(fd >= 0)
+        ::close(fd);
+    fd = -1;
+}
+
+} // namespace UI
@@ -0,0 +1,106 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <cstdint>
+#include <vector>
+#include "ui.h"
+#include "font.h"
+
+namespace UI {
+
+/* Draw list streaming ****************************************************** */
+/* Frames are sent to a display process as packets : a fixed header followed
+ * by the encoded commands.
+ *
+ * header (20 bytes, little endian) : 'U' 'D', version, flags (STREAM_KEYFRAME),
+ * payload size (u32), frame number (u32), timestamp (u64, microseconds of
+ * the sender's steady clock, for latency measurements on the same host).
+ *
+ * payload : command count (varint), then tokens until the count is reached
+ *  - 0x80, n (varint) : the next n commands are the same as in the previous
+ *    frame, at the same positions
+ *  - op | flags : a new command. Its rectangle is 4 zigzag varints, deltas
+ *    against the command at the same position in the previous frame (or
+ *    zero). The color (4 bytes) and the text (varint length + bytes) follow
+ *    unless STREAM_SAME_COLOR / STREAM_SAME_TEXT say they didn't change.
+ *    CLIP_END has no fields. DRAW_TEXT carries the font size in the
+ *    rectangle's w, and frames with a size the display can't bake are
+ *    rejected. DRAW_IMAGE carries the sprite index in the rectangle's w,
+ *    and refers to the atlas the display has opened.
+ * Keyframes don't reference the previous frame at all. */
+
+enum STREAM_FLAGS {
+    STREAM_KEYFRAME = 1 << 0
+};
+
+enum STREAM_TOKEN {
+    STREAM_OP_MASK = 0x07,
+    STREAM_SAME_COLOR = 1 << 3,
+    STREAM_SAME_TEXT = 1 << 4,
+    STREAM_COPY = 0x80
+};
+
+class StreamHeader {
+public:
+    static const size_t size = 20;
+    static const uint8_t version = 2;
+    /* keyframes of the demo take about 1 KB, and a full no-heap draw list
+     * (UI_MAX_DRAW_COMMANDS, UI_MAX_DRAW_TEXT) about 20 KB */
+    static const uint32_t max_payload_size = 1 << 20;
+    uint8_t flags = 0;
+    uint32_t payload_size = 0;
+    uint32_t frame = 0;
+    uint64_t timestamp = 0;
+    /* false if data isn't a header of this version, or announces a
+     * payload larger than max_payload_size */
+    bool parse(const uint8_t *data);
+};
+
+class DrawListEncoder {
+public:
+    /* returns the whole packet, valid until the next call */
+    const std::vector<uint8_t> &encode(const DrawList &list, uint32_t frame, uint64_t timestamp, bool keyframe);
+private:
+    std::vector<uint8_t> packet;
+    DrawList previous;
+};
+
+class DrawListDecoder {
+public:
+    /* returns nullptr on a malformed payload, or a delta without its
+     * previous frame. After a failure, deltas are refused until the next
+     * keyframe. */
+    const DrawList *decode(const StreamHeader &header, const uint8_t *payload);
+private:
+    /* decodes into current, against prev (nullptr for a keyframe) */
+    bool decode_payload(const DrawList *prev, const uint8_t *payload, size_t size);
+    /* false for a DRAW_TEXT font size the display's Fonts couldn't bake, or
+     * a size past the ones it has room for */
+    bool check_font_sizes();
+    DrawList previous, current;
+    bool has_previous = false;
+    int font_sizes[Fonts::max_atlases];
+    int font_size_count = 0;
+};
+
+/* Client end of a Unix-domain socket carrying the packets. Frames are encoded
+ * once into a reused buffer and written with a single send. */
+class DrawListStream {
+public:
+    ~DrawListStream() { close(); }
+    bool connect(const char *path);
+    bool send(const DrawList &list);
+    void close();
+    int keyframe_interval = 60; // a keyframe every n frames
+    unsigned long frames = 0, bytes = 0, keyframe_bytes = 0;
+private:
+    DrawListEncoder encoder;
+    int fd = -1;
+};
+
+/* steady clock in microseconds, the time base of StreamHeader::timestamp */
+uint64_t stream_clock(void);
+
+} // namespace UI
+
+#endif
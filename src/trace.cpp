@@ -0,0 +1,124 @@
+#include <cstring>
+#include "trace.h"
+
+namespace UI {
+
+static const char trace_magic[4] = {'U', 'I', 'T', 'R'};
+static const uint8_t trace_version = 2;
+
+static void put_u16(FILE *f, int v) {
+    fputc(v & 0xff, f);
+    fputc((v >> 8) & 0xff, f);
+}
+
+static int get_u16(FILE *f) {
+    int lo = fgetc(f);
+    int hi = fgetc(f);
+    if(lo == EOF || hi == EOF)
+        return -1;
+    return lo | (hi << 8);
+}
+
+bool TraceWriter::open(const char *path, uint8_t flags, Vec2<int> screen_size) {
+    close();
+    file = fopen(path, "wb");
+    if(file == nullptr)
+        return false;
+    this->flags = flags;
+    last_time = 0;
+    frames = 0;
+    fwrite(trace_magic, 1, sizeof(trace_magic), file);
+    fputc(trace_version, file);
+    fputc(flags, file);
+    put_u16(file, screen_size.x);
+    put_u16(file, screen_size.y);
+    return !ferror(file);
+}
+
+void TraceWriter::frame(const TraceFrame &f) {
+    if(file == nullptr)
+        return;
+    unsigned long delta = f.time - last_time;
+    last_time = f.time;
+    do {
+        uint8_t byte = delta & 0x7f;
+        delta >>= 7;
+        fputc(delta ? byte | 0x80 : byte, file);
+    } while(delta);
+    fputc(f.keys, file);
+    if(flags & TRACE_HASHES) {
+        for(int i = 0; i < 4; i++)
+            fputc((f.hash >> (8 * i)) & 0xff, file);
+    }
+    frames++;
+}
+
+bool TraceWriter::close() {
+    if(file == nullptr)
+        return true;
+    bool ok = !ferror(file);
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+bool TraceReader::open(const char *path) {
+    close();
+    file = fopen(path, "rb");
+    if(file == nullptr)
+        return false;
+    char magic[4];
+    const int version = fread(magic, 1, sizeof(magic), file) == sizeof(magic)
+        && memcmp(magic, trace_magic, sizeof(magic)) == 0 ? fgetc(file) : EOF;
+    const int c = fgetc(file);
+    size = Vec2<int>(320, 240);
+    if(version == trace_version) {
+        size.x = get_u16(file);
+        size.y = get_u16(file);
+    }
+    if((version != 1 && version != trace_version) || c == EOF || size.x <= 0 || size.y <= 0) {
+        close();
+        return false;
+    }
+    flags = c;
+    last_time = 0;
+    return true;
+}
+
+bool TraceReader::next(TraceFrame &f) {
+    if(file == nullptr)
+        return false;
+    unsigned long delta = 0;
+    int shift = 0, c;
+    do {
+        c = fgetc(file);
+        if(c == EOF || shift >= (int)sizeof(delta) * 8)
+            return false;
+        delta |= (unsigned long)(c & 0x7f) << shift;
+        shift += 7;
+    } while(c & 0x80);
+    c = fgetc(file);
+    if(c == EOF)
+        return false;
+    last_time += delta;
+    f.time = last_time;
+    f.keys = c;
+    f.hash = 0;
+    if(flags & TRACE_HASHES) {
+        for(int i = 0; i < 4; i++) {
+            c = fgetc(file);
+            if(c == EOF)
+                return false;
+            f.hash |= (ui_id)c << (8 * i);
+        }
+    }
+    return true;
+}
+
+void TraceReader::close() {
+    if(file != nullptr)
+        fclose(file);
+    file = nullptr;
+}
+
+} // namespace UI
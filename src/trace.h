@@ -0,0 +1,66 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdio>
+#include <cstdint>
+#include "ui.h"
+
+namespace UI {
+
+/* Input traces ************************************************************* */
+/* A trace is what a session fed into the ui : for every frame, the time the
+ * frame saw (Context::frame_time) and the keys held (Context::key_state),
+ * optionally with the hash of the frame's draw commands.
+ *
+ * File layout : "UITR", version byte, flags byte, screen width and height
+ * (16 bit little endian), then one record per frame : time delta since the
+ * previous frame (LEB128 varint, milliseconds), key bitmask byte, and the 32
+ * bit little endian frame hash if TRACE_HASHES is set. A steady 60 fps
+ * session costs 2 bytes per frame without hashes. Version 1 traces have no
+ * screen size, they were all 320 x 240. */
+
+enum TRACE_FLAGS {
+    TRACE_HASHES = 1 << 0,
+    TRACE_IMMEDIATE_NAVIGATION = 1 << 1 // Context::set_immediate_navigation
+};
+
+class TraceFrame {
+public:
+    unsigned long time = 0;
+    uint8_t keys = 0;
+    ui_id hash = 0;
+};
+
+class TraceWriter {
+public:
+    ~TraceWriter() { close(); }
+    bool open(const char *path, uint8_t flags, Vec2<int> screen_size);
+    void frame(const TraceFrame &f);
+    bool close();
+    unsigned long frames = 0;
+private:
+    FILE *file = nullptr;
+    uint8_t flags = 0;
+    unsigned long last_time = 0;
+};
+
+class TraceReader {
+public:
+    ~TraceReader() { close(); }
+    bool open(const char *path);
+    /* false at the end of the trace, or if it is truncated */
+    bool next(TraceFrame &f);
+    void close();
+    bool has_hashes() const { return flags & TRACE_HASHES; }
+    bool has_immediate_navigation() const { return flags & TRACE_IMMEDIATE_NAVIGATION; }
+    Vec2<int> screen_size() const { return size; }
+private:
+    FILE *file = nullptr;
+    uint8_t flags = 0;
+    Vec2<int> size;
+    unsigned long last_time = 0;
+};
+
+} // namespace UI
+
+#endif
@@ -5,9 +5,14 @@
 #include <cstddef>
 #include <climits>
 #include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <type_traits>
+#ifndef UI_NO_HEAP
 #include <vector>
 #include <unordered_map>
 #include <string>
+#endif
 
 #define ui_assert(x)                                                            \
     do {                                                                        \
@@ -17,12 +22,15 @@
 
 #define UI_ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 
+extern void ui_error(const char *fmt, ...); // see the backend functions below
+
 namespace UI {
 
 typedef unsigned int ui_id;
 
 class Color {
 public:
+    Color() {}
     Color(uint8_t r, uint8_t g, uint8_t b, uint8_t a) : r(r), g(g), b(b), a(a) {}
     static Color black() { return Color(0, 0, 0, 255); }
     static Color white() { return Color(255, 255, 255, 255); }
@@ -44,28 +52,108 @@ public:
 #define UI_COLOR_DARKGREY (ui_color){.r = 128, .g = 128, .b = 128, .a = 255}
 /* ************************************************************************** */
 
+/* Fixed point ************************************************************** */
+/* Signed numbers with FRAC fractional bits in an int32_t, for targets without
+ * an FPU : sums are integer sums, products and quotients go through 64 bits,
+ * and nothing is converted to or from float at run time (constants come from
+ * ratio()). UI::fixed is the Q16.16 instance, see UI_FIXED_FRAC. They work as
+ * the T of Vec2, Rectangle and Context::input_number. */
+template <int FRAC>
+class Fixed {
+public:
+    static_assert(FRAC > 0 && FRAC < 28, "Fixed needs 1 to 27 fractional bits");
+    static const int32_t one = (int32_t)1 << FRAC;
+    /* the integer range, e.g. -32768..32767 for Q16.16 */
+    static const int64_t max_int = ((int64_t)1 << (31 - FRAC)) - 1, min_int = -max_int - 1;
+    Fixed() {}
+    /* from any integer type, out of range values are reported by ui_error */
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    Fixed(T x) {
+        if(x >= 0 ? (uint64_t)x > (uint64_t)max_int : (int64_t)x < min_int)
+            ui_error("integer out of the fixed point range (%lld..%lld)", (long long)min_int, (long long)max_int);
+        raw = (int32_t)((int64_t)x * one);
+    }
+    /* 0.1 would truncate to 0, use ratio() */
+    template <typename T, typename std::enable_if<std::is_floating_point<T>::value, int>::type = 0>
+    Fixed(T) = delete;
+    static Fixed from_raw(int32_t raw) {
+        Fixed f;
+        f.raw = raw;
+        return f;
+    }
+    /* num / den (den > 0) rounded to the nearest, e.g. ratio(1, 10) for 0.1 */
+    static Fixed ratio(int num, int den) {
+        const int64_t n = (int64_t)num * one;
+        return from_raw((n + (n < 0 ? -den / 2 : den / 2)) / den);
+    }
+    int to_int() const { return raw >> FRAC; } // rounds down
+    /* x times this number, as an int (rounded down) : scaling without the
+     * range limit of converting x first */
+    int times(int x) const { return (int64_t)x * raw >> FRAC; }
+    Fixed operator+(Fixed other) const { return from_raw(raw + other.raw); }
+    Fixed operator-(Fixed other) const { return from_raw(raw - other.raw); }
+    Fixed operator-() const { return from_raw(-raw); }
+    Fixed operator*(Fixed other) const { return from_raw((int64_t)raw * other.raw >> FRAC); }
+    Fixed operator/(Fixed other) const { return from_raw((int64_t)raw * one / other.raw); }
+    Fixed &operator+=(Fixed other) { raw += other.raw; return *this; }
+    Fixed &operator-=(Fixed other) { raw -= other.raw; return *this; }
+    bool operator==(Fixed other) const { return raw == other.raw; }
+    bool operator!=(Fixed other) const { return raw != other.raw; }
+    bool operator<(Fixed other) const { return raw < other.raw; }
+    bool operator>(Fixed other) const { return raw > other.raw; }
+    bool operator<=(Fixed other) const { return raw <= other.raw; }
+    bool operator>=(Fixed other) const { return raw >= other.raw; }
+    int32_t raw = 0;
+};
+
+/* Sums of products (Vec2::dot), wide enough not to overflow : int64_t for
+ * int, and for Fixed<FRAC> an int64_t with FRAC fractional bits (the raw
+ * value of a 64 bit Fixed) */
+template <typename T>
+class Product {
+public:
+    typedef T type;
+    static T sum(T a, T b, T c, T d) { return a * b + c * d; }
+};
+
+template <>
+class Product<int> {
+public:
+    typedef int64_t type;
+    static int64_t sum(int a, int b, int c, int d) { return (int64_t)a * b + (int64_t)c * d; }
+};
+
+template <int FRAC>
+class Product<Fixed<FRAC> > {
+public:
+    typedef int64_t type;
+    static int64_t sum(Fixed<FRAC> a, Fixed<FRAC> b, Fixed<FRAC> c, Fixed<FRAC> d) {
+        return ((int64_t)a.raw * b.raw >> FRAC) + ((int64_t)c.raw * d.raw >> FRAC);
+    }
+};
+
 template <typename T>
 class Vec2 {
 public:
     Vec2() : x(0), y(0) {}
     Vec2(T x, T y) : x(x), y(y) {}
-    Vec2 operator+(Vec2 const& other) {
+    Vec2 operator+(Vec2 const& other) const {
         Vec2 res;
         res.x = x + other.x;
         res.y = y + other.y;
         return res;
     }
-    Vec2 operator-(Vec2 const& other) {
+    Vec2 operator-(Vec2 const& other) const {
         Vec2 res;
         res.x = x - other.x;
         res.y = y - other.y;
         return res;
     }
-    T dot(Vec2 other) {
-        return x * other.x + y * other.y;
+    typename Product<T>::type dot(Vec2 other) const {
+        return Product<T>::sum(x, other.x, y, other.y);
     }
-    int mag_squared() {
-        return x * x + y * y;
+    typename Product<T>::type mag_squared() const {
+        return dot(*this);
     }
     T x = 0, y = 0;
 };
@@ -73,10 +161,11 @@ public:
 template <typename T>
 class Rectangle {
 public:
+    Rectangle() {}
     Rectangle(T x, T y, T w, T h) : x(x), y(y), w(w), h(h) {}
     Rectangle(Vec2<T> xy, Vec2<T> wh) : x(xy.x), y(xy.y), w(wh.x), h(wh.y) {}
-    Vec2<T> xy() { return Vec2<T>(x, y); }
-    Vec2<T> wh() { return Vec2<T>(w, h); }
+    Vec2<T> xy() const { return Vec2<T>(x, y); }
+    Vec2<T> wh() const { return Vec2<T>(w, h); }
     T x = 0, y = 0, w = 0, h = 0;
 };
 
@@ -87,14 +176,207 @@ extern void ui_draw_rectangle(UI::Rectangle<int> rect, UI::Color color);
 extern void ui_fill_rectangle(UI::Rectangle<int> rect, UI::Color color);
 extern void ui_draw_text(const char *msg, UI::Vec2<int> pos, int font_size, UI::Color color);
 extern int ui_get_text_width(const char *text, int font_size);
+extern void ui_draw_image(int image, UI::Vec2<int> pos);
+extern UI::Vec2<int> ui_get_image_size(int image);
 extern void ui_clip(UI::Rectangle<int> rect);
 extern void ui_clip_end(void);
 extern unsigned long ui_millis(void);
 extern void ui_error(const char *fmt, ...);
 /* ************************************************************************** */
 
+/* Build configuration ****************************************************** */
+/* With UI_NO_HEAP defined, Context doesn't allocate at all : every dynamic
+ * structure is a fixed-capacity container sized by the macros below (they
+ * can be overridden on the command line), and running out of room is
+ * reported through ui_error. `make footprint` prints the resulting static
+ * RAM use. */
+#ifndef UI_MAX_CONTAINERS
+#define UI_MAX_CONTAINERS 8     // nesting depth of begin_container()
+#endif
+#ifndef UI_MAX_ID_STACK
+#define UI_MAX_ID_STACK 8       // depth of push_id()
+#endif
+#ifndef UI_MAX_WIDGETS
+#define UI_MAX_WIDGETS 128      // selectable widgets per frame
+#endif
+#ifndef UI_MAX_TEXT
+#define UI_MAX_TEXT 32          // capacity of UI::String, including the nul
+#endif
+#ifndef UI_MAX_DRAW_COMMANDS
+#define UI_MAX_DRAW_COMMANDS 512
+#endif
+#ifndef UI_MAX_DRAW_TEXT
+#define UI_MAX_DRAW_TEXT 4096   // bytes of text in a draw list
+#endif
+/* UI_FIXED_FRAC sets the fractional bits of UI::fixed. With UI_FIXED_POINT
+ * defined, UI::real (the type for fractional values in application code) is
+ * UI::fixed instead of float. */
+#ifndef UI_FIXED_FRAC
+#define UI_FIXED_FRAC 16
+#endif
+#ifndef UI_MAX_TEXT_LAYOUTS
+#define UI_MAX_TEXT_LAYOUTS 4   // paragraphs whose line breaks are cached
+#endif
+#ifndef UI_MAX_TEXT_LINES
+#define UI_MAX_TEXT_LINES 64    // lines of a paragraph, the rest isn't shown
+#endif
+#ifndef UI_MAX_FONT_SIZE
+#define UI_MAX_FONT_SIZE 16     // largest baked font, an atlas takes 12 x size^2 bytes
+#endif
+/* ************************************************************************** */
+
 namespace UI {
 
+typedef Fixed<UI_FIXED_FRAC> fixed;
+#ifdef UI_FIXED_POINT
+typedef fixed real;
+inline real real_ratio(int num, int den) { return fixed::ratio(num, den); }
+#else
+typedef float real;
+inline real real_ratio(int num, int den) { return (float)num / den; }
+#endif
+
+/* Fixed-capacity containers ************************************************ */
+/* Just enough of std::vector, std::unordered_map and std::string for what
+ * Context does with them. */
+
+template <typename T, size_t N>
+class FixedVector {
+public:
+    typedef T *iterator;
+    typedef const T *const_iterator;
+    void push_back(const T &x) {
+        if(n == N)
+            ui_error("FixedVector overflow (capacity %d)", (int)N);
+        items[n++] = x;
+    }
+    void pop_back() { n--; }
+    T &back() { return items[n - 1]; }
+    T &operator[](size_t i) { return items[i]; }
+    const T &operator[](size_t i) const { return items[i]; }
+    void insert(iterator pos, const T *first, const T *last) {
+        const size_t count = last - first, at = pos - items;
+        if(n + count > N)
+            ui_error("FixedVector overflow (capacity %d)", (int)N);
+        for(size_t i = n; i > at; i--)
+            items[i - 1 + count] = items[i - 1];
+        for(size_t i = 0; i < count; i++)
+            items[at + i] = first[i];
+        n += count;
+    }
+    void resize(size_t count) {
+        if(count > N)
+            ui_error("FixedVector overflow (capacity %d)", (int)N);
+        n = count;
+    }
+    void assign(size_t count, const T &x) {
+        resize(count);
+        for(size_t i = 0; i < n; i++)
+            items[i] = x;
+    }
+    size_t size() const { return n; }
+    size_t max_size() const { return N; }
+    bool empty() const { return n == 0; }
+    void clear() { n = 0; }
+    T *data() { return items; }
+    const T *data() const { return items; }
+    iterator begin() { return items; }
+    iterator end() { return items + n; }
+    const_iterator begin() const { return items; }
+    const_iterator end() const { return items + n; }
+private:
+    T items[N];
+    size_t n = 0;
+};
+
+/* open addressing on the keys (ids are hashes already), entries are kept in
+ * insertion order for iteration */
+template <typename K, typename V, size_t N>
+class FixedMap {
+public:
+    class Entry {
+    public:
+        K first;
+        V second;
+    };
+    FixedMap() { clear(); }
+    size_t count(K key) const { return find(key) != 0; }
+    V &operator[](K key) {
+        size_t slot = (size_t)key % SLOTS;
+        while(slots[slot] != 0) {
+            if(entries[slots[slot] - 1].first == key)
+                return entries[slots[slot] - 1].second;
+            slot = (slot + 1) % SLOTS;
+        }
+        if(n == N)
+            ui_error("FixedMap overflow (capacity %d)", (int)N);
+        entries[n].first = key;
+        entries[n].second = V();
+        slots[slot] = ++n;
+        return entries[n - 1].second;
+    }
+    void clear() {
+        memset(slots, 0, sizeof(slots));
+        n = 0;
+    }
+    size_t size() const { return n; }
+    Entry *begin() { return entries; }
+    Entry *end() { return entries + n; }
+private:
+    static const size_t SLOTS = 2 * N;
+    size_t find(K key) const {
+        size_t slot = (size_t)key % SLOTS;
+        while(slots[slot] != 0) {
+            if(entries[slots[slot] - 1].first == key)
+                return slots[slot];
+            slot = (slot + 1) % SLOTS;
+        }
+        return 0;
+    }
+    uint16_t slots[SLOTS]; // index in entries + 1, 0 : empty
+    Entry entries[N];
+    size_t n;
+};
+
+template <size_t N>
+class FixedString {
+public:
+    FixedString(const char *s = "") { assign(s); }
+    const char *c_str() const { return buf; }
+    size_t size() const { return n; }
+    size_t length() const { return n; }
+    size_t capacity() const { return N - 1; }
+    void pop_back() { buf[--n] = 0; }
+    FixedString &append(const char *s) {
+        const size_t len = strlen(s);
+        if(n + len >= N)
+            ui_error("FixedString overflow (capacity %d)", (int)N - 1);
+        memcpy(buf + n, s, len + 1);
+        n += len;
+        return *this;
+    }
+    FixedString &operator=(const char *s) { return assign(s); }
+private:
+    FixedString &assign(const char *s) {
+        n = 0;
+        buf[0] = 0;
+        return append(s);
+    }
+    char buf[N];
+    size_t n;
+};
+
+#ifdef UI_NO_HEAP
+template <typename T, size_t N> using Vector = FixedVector<T, N>;
+template <typename K, typename V, size_t N> using Map = FixedMap<K, V, N>;
+typedef FixedString<UI_MAX_TEXT> String;
+#else
+template <typename T, size_t N> using Vector = std::vector<T>;
+template <typename K, typename V, size_t N> using Map = std::unordered_map<K, V>;
+typedef std::string String;
+#endif
+/* ************************************************************************** */
+
 enum KEY {
     NONE = 0,
     UP = 1 << 0,
@@ -111,27 +393,35 @@ class Input {
 public:
     void set_key_state(enum KEY key, bool state) {
         uint8_t mask = ~key;
+        if(state && !(this->state & key) && !has_edge) { // remember when the first new key went down
+            has_edge = true;
+            edge_time = ui_millis();
+        }
         new_state &= mask;
         new_state |= state ? key : 0;
     }
     void update() {
+        now = ui_millis(); // sampled once, so a frame only sees one point in time
+        frame_has_edge = has_edge;
+        frame_edge_time = edge_time;
+        has_edge = false;
         events = ~state & new_state; // detect rising edge
         if(events != 0) {
-            timestamp = ui_millis(); // we reset the timestamp when new keys are pressed
+            timestamp = now; // we reset the timestamp when new keys are pressed
             is_repeat = false;
         }
         if(new_state == 0)
             is_repeat = false;
         if(is_repeat) { // a repetition has already started
-            if(ui_millis() - timestamp > key_repeat_interval) {
+            if(now - timestamp > key_repeat_interval) {
                 events |= new_state;
-                timestamp = ui_millis();
+                timestamp = now;
             }
         } else { // we check if we need to start a key repetition
-            if((state & new_state) && ui_millis() - timestamp > key_repeat_delay) {
+            if((state & new_state) && now - timestamp > key_repeat_delay) {
                 events |= new_state;
                 is_repeat = true;
-                timestamp = ui_millis();
+                timestamp = now;
             }
         }
     }
@@ -144,10 +434,23 @@ public:
     void end_frame() {
         state = new_state;
     }
+    uint8_t key_state() {
+        return new_state;
+    }
+    unsigned long frame_time() {
+        return now;
+    }
+    /* true if a key went down since the previous frame, and when */
+    bool input_edge(unsigned long *time) {
+        *time = frame_edge_time;
+        return frame_has_edge;
+    }
 private:
     uint8_t state = 0, new_state = 0, events = 0; // state: saved key states, new_state: updated key states, events: detects rising edges of keys
-    unsigned long timestamp = 0;
+    unsigned long timestamp = 0, now = 0;
     bool is_repeat = false;
+    bool has_edge = false, frame_has_edge = false;
+    unsigned long edge_time = 0, frame_edge_time = 0;
     const unsigned long key_repeat_delay = 500, key_repeat_interval = 30; // in milliseconds
 };
 
@@ -189,12 +492,13 @@ private:
         return id;
     }
     const ui_id FNV_PRIME = 16777619, FNV_OFFSET_BASIS = 2166136261;
-    std::vector<ui_id> stack;
+    Vector<ui_id, UI_MAX_ID_STACK> stack;
 };
 
 
 class Container {
 public:
+    Container() : bounds(0, 0, 0, 0) {}
     Container(Vec2<int> origin) : bounds(origin.x, origin.y, 0, 0), cursor(0, 0) {}
     void update_cursor(Vec2<int> wh) { 
         cursor.x += wh.x;
@@ -209,11 +513,217 @@ public:
     Vec2<int> cursor;
 };
 
+/* Draw lists *************************************************************** */
+/* A frame's draw commands, recorded instead of being sent to the backend
+ * (see Context::set_draw_list) so they can be rendered later, possibly on
+ * another thread. Text is copied into the list. The buffers keep their
+ * capacity across frames, so a list stops allocating after a few frames. */
+
+enum DRAW_OP { DRAW_RECTANGLE, FILL_RECTANGLE, DRAW_TEXT, CLIP, CLIP_END, DRAW_IMAGE };
+
+class DrawCommand {
+public:
+    uint8_t op = 0;
+    Rectangle<int> rect; // for DRAW_TEXT : x, y and the font size in w, for DRAW_IMAGE : x, y and the image in w
+    Color color;
+    uint32_t text = 0; // offset in DrawList::text
+};
+
+class DrawList {
+public:
+    void clear() {
+        commands.clear();
+        text.clear();
+        has_input_edge = false;
+    }
+    void push(DRAW_OP op, Rectangle<int> rect, Color color, const char *msg = nullptr) {
+        DrawCommand cmd;
+        cmd.op = op;
+        cmd.rect = rect;
+        cmd.color = color;
+        cmd.text = text.size();
+        if(msg != nullptr)
+            text.insert(text.end(), msg, msg + strlen(msg) + 1);
+        commands.push_back(cmd);
+    }
+    /* sends the commands to the backend */
+    void render() const {
+        for(size_t i = 0; i < commands.size(); i++) {
+            const DrawCommand &cmd = commands[i];
+            switch(cmd.op) {
+                case DRAW_RECTANGLE:
+                    ui_draw_rectangle(cmd.rect, cmd.color);
+                    break;
+                case FILL_RECTANGLE:
+                    ui_fill_rectangle(cmd.rect, cmd.color);
+                    break;
+                case DRAW_TEXT:
+                    ui_draw_text(&text[cmd.text], cmd.rect.xy(), cmd.rect.w, cmd.color);
+                    break;
+                case CLIP:
+                    ui_clip(cmd.rect);
+                    break;
+                case CLIP_END:
+                    ui_clip_end();
+                    break;
+                case DRAW_IMAGE:
+                    ui_draw_image(cmd.rect.w, cmd.rect.xy());
+                    break;
+            }
+        }
+    }
+    Vector<DrawCommand, UI_MAX_DRAW_COMMANDS> commands;
+    Vector<char, UI_MAX_DRAW_TEXT> text;
+    /* set when the frame is the first to show the response to a key press,
+     * so whoever presents it can measure the latency (see LatencyStats) */
+    bool has_input_edge = false;
+    unsigned long input_edge_time = 0;
+};
+
+/* Text layout ************************************************************** */
+/* Line breaks of a paragraph (see Context::paragraph), kept across frames and
+ * redone only when the text, the wrapping width or the font size change. Lines
+ * break at spaces, at '\n', or inside a word too wide for a line of its own.
+ * When the text only grew (a log being appended to), the lines before the
+ * last one can't change, so only the last line is broken again. */
+
+class TextLine {
+public:
+    uint32_t start = 0, length = 0;
+    int width = 0;
+};
+
+class TextLayout {
+public:
+    static const size_t max_line_length = 255;
+#ifdef UI_NO_HEAP
+    static const size_t max_lines = UI_MAX_TEXT_LINES;
+#else
+    static const size_t max_lines = SIZE_MAX;
+#endif
+    void reset(ui_id id) {
+        this->id = id;
+        hash = 0;
+        length = 0;
+        width = -1;
+        font_size = 0;
+        lines.clear();
+    }
+    void update(const char *text, int wrap_width, int font_size) {
+        const size_t len = strlen(text);
+        ui_id h = FNV_OFFSET_BASIS;
+        size_t from = 0;
+        if(wrap_width == width && font_size == this->font_size && len >= length) {
+            h = hash_text(h, text, length);
+            if(h == hash && len == length)
+                return;
+            if(h == hash && !lines.empty()) {
+                from = lines.back().start;
+                lines.pop_back();
+            }
+        }
+        if(from == 0) {
+            lines.clear();
+            h = hash_text(FNV_OFFSET_BASIS, text, len);
+        } else {
+            h = hash_text(h, text + length, len - length);
+        }
+        hash = h;
+        length = len;
+        width = wrap_width;
+        this->font_size = font_size;
+        break_lines(text, len, from);
+    }
+    ui_id id = 0;
+    unsigned long last_use = 0;
+    Vector<TextLine, UI_MAX_TEXT_LINES> lines;
+private:
+    void break_lines(const char *text, size_t len, size_t start) {
+        while(lines.size() < max_lines) {
+            size_t end = start, i = start;
+            int end_width = 0;
+            for(;;) {
+                size_t j = i;
+                while(j < len && text[j] != ' ' && text[j] != '\n')
+                    j++;
+                const int w = measure(text + start, j - start);
+                if(w > width) {
+                    if(end == start && j > start) // a word wider than the line, cut it
+                        end = start + longest_fit(text + start, j - start, &end_width);
+                    break;
+                }
+                end = j;
+                end_width = w;
+                if(j == len || text[j] != ' ')
+                    break;
+                i = j + 1;
+            }
+            TextLine line;
+            line.start = start;
+            line.length = end - start;
+            line.width = end_width;
+            lines.push_back(line);
+            if(end >= len)
+                return;
+            start = text[end] == ' ' || text[end] == '\n' ? end + 1 : end;
+        }
+    }
+    int measure(const char *text, size_t len) {
+        if(len > max_line_length)
+            return INT_MAX;
+        char buf[max_line_length + 1];
+        memcpy(buf, text, len);
+        buf[len] = 0;
+        return ui_get_text_width(buf, font_size);
+    }
+    /* the number of characters that fit (at least one, len > 0) */
+    size_t longest_fit(const char *text, size_t len, int *fit_width) {
+        size_t lo = 1, hi = std::min(len, (size_t)max_line_length);
+        *fit_width = measure(text, 1);
+        while(lo < hi) {
+            const size_t mid = (lo + hi + 1) / 2;
+            const int w = measure(text, mid);
+            if(w <= width) {
+                lo = mid;
+                *fit_width = w;
+            } else {
+                hi = mid - 1;
+            }
+        }
+        return lo;
+    }
+    static ui_id hash_text(ui_id h, const char *text, size_t len) {
+        while(len--)
+            h = (h ^ (unsigned char)*text++) * FNV_PRIME;
+        return h;
+    }
+    ui_id hash = 0;
+    size_t length = 0;
+    int width = -1, font_size = 0;
+    static const ui_id FNV_PRIME = 16777619, FNV_OFFSET_BASIS = 2166136261;
+};
+
+/* Input latency, in milliseconds, from a key going down to the first frame
+ * showing its effect being on screen */
+class LatencyStats {
+public:
+    void add(unsigned long ms) {
+        last = ms;
+        if(count == 0 || ms < min) min = ms;
+        if(ms > max) max = ms;
+        total += ms;
+        count++;
+    }
+    unsigned long mean() const {
+        return count ? total / count : 0;
+    }
+    unsigned long last = 0, min = 0, max = 0, total = 0, count = 0;
+};
+
 class VirtualKeyboardData {
 public:
-    VirtualKeyboardData(std::string &text_input, size_t max_size = 0) : text_input(text_input), max_size(max_size) {}
-    std::string &text_input;
-    const size_t max_size;
+    String *text_input = nullptr;
+    size_t max_size = 0;
 };
 
 
@@ -228,6 +738,7 @@ public:
 
     void init(int screen_width, int screen_height) {
         screen_size = Vec2<int>(screen_width, screen_height);
+        slider_content = Vec2<int>(-1, -1);
         hot_item = 0;
         active_item = 0;
         frame = 0;
@@ -236,35 +747,99 @@ public:
     void set_key_state(enum KEY key, bool state) {
         input.set_key_state(key, state);
     }
+
+    /* keys held during the current frame, as a KEY bitmask */
+    uint8_t key_state() {
+        return input.key_state();
+    }
+
+    /* ui_millis() as seen by the current frame */
+    unsigned long frame_time() {
+        return input.frame_time();
+    }
+
+    /* when enabled, every draw command of a frame is folded into a hash,
+     * readable after end_frame(). Replays use it to check they are
+     * deterministic. */
+    void enable_frame_hash(bool enable) {
+        frame_hash_enabled = enable;
+    }
+
+    ui_id frame_hash() {
+        return hash;
+    }
+
+    /* records the draw commands into list rather than drawing them right
+     * away, until set back to nullptr. The list isn't cleared. */
+    void set_draw_list(DrawList *list) {
+        draw_list = list;
+    }
+
+    /* moves the hot item in begin_frame(), from the widgets of the previous
+     * frame, instead of in end_frame() : the new highlight is drawn in the
+     * frame that saw the key press rather than in the next one */
+    void set_immediate_navigation(bool enable) {
+        immediate_navigation = enable;
+    }
+
+    /* to be called once the frame is on screen (after the backend's flush
+     * or buffer swap), for the input latency measurement */
+    void present() {
+        if(frame_has_edge)
+            latency.add(ui_millis() - frame_edge_time);
+        if(new_has_edge)
+            latency.add(ui_millis() - new_edge_time);
+        frame_has_edge = new_has_edge = false;
+    }
+
+    const LatencyStats &input_latency() {
+        return latency;
+    }
+
+    /* sets all the keys at once from a KEY bitmask */
+    void set_keys(uint8_t keys) {
+        static const KEY all_keys[] = {UP, DOWN, LEFT, RIGHT, A, B, SELECT, START};
+        for(size_t i = 0; i < UI_ARRAY_SIZE(all_keys); i++)
+            input.set_key_state(all_keys[i], keys & all_keys[i]);
+    }
     
     void begin_frame() {
         hot_item_exists = false;
-        widgets_locations.clear();
         id_stack.clear();
         style = Style();
         content_size = Vec2<int>(0, 0);
+        hash = FNV_OFFSET_BASIS;
         input.update();
+        // the press deferred by the last frame shows in this one, and a new
+        // press is measured on its own
+        frame_has_edge = deferred_has_edge;
+        frame_edge_time = deferred_edge_time;
+        deferred_has_edge = false;
+        new_has_edge = input.input_edge(&new_edge_time);
+        if(immediate_navigation)
+            navigate(); // with last frame's widgets, before anything is drawn
+        widgets_locations.clear();
         frame++;
     }
 
     void end_frame() {
+        update_slider_scale();
         if(content_size.x > screen_size.x)
             draw_h_slider();
-        if(content_size.x > screen_size.x)
+        if(content_size.y > screen_size.y)
             draw_v_slider();
         if(input.pressed_keys() != KEY::A)
             active_item = 0;
-        Vec2<int> dir;
-        if(input.pressed_keys() == KEY::UP)
-            dir.y--;
-        if(input.pressed_keys() == KEY::DOWN)
-            dir.y++;
-        if(input.pressed_keys() == KEY::LEFT)
-            dir.x--;
-        if(input.pressed_keys() == KEY::RIGHT)
-            dir.x++;
-        if(dir.x != 0 || dir.y != 0)
-            update_hot_item_by_direction(dir);
+        if(!immediate_navigation && navigate() && new_has_edge) {
+            // the new hot item only shows up in the next frame
+            deferred_has_edge = true;
+            deferred_edge_time = new_edge_time;
+            new_has_edge = false;
+        }
+        if(draw_list != nullptr) { // the earliest edge, see FramePipeline
+            draw_list->has_input_edge = frame_has_edge || new_has_edge;
+            draw_list->input_edge_time = frame_has_edge ? frame_edge_time : new_edge_time;
+        }
         input.end_frame();
         ui_assert(container_stack.empty());
         ui_assert(id_stack.empty());
@@ -304,7 +879,7 @@ public:
         id_stack.push((void*)s, size);
     }
 
-    void push_id(std::string s) {
+    void push_id(const String &s) {
         id_stack.push((void*)s.c_str(), s.length());
     }
 
@@ -313,16 +888,14 @@ public:
     }
 
     void set_next_widget_size(int w, int h) {
-        next_widget_size = new Vec2<int>(w, h);
+        next_widget_size = Vec2<int>(w, h);
+        has_next_widget_size = true;
     }
 
     Vec2<int> get_widget_size(int w, int h) {
-        Vec2<int> res;
-        if(next_widget_size != nullptr) {
-            res = *next_widget_size;
-            delete next_widget_size;
-            next_widget_size = nullptr;
-            return res;
+        if(has_next_widget_size) {
+            has_next_widget_size = false;
+            return next_widget_size;
         } else {
             return Vec2<int>(w, h);
         }
@@ -339,9 +912,65 @@ public:
         Vec2<int> origin = container->bounds.xy();
         Vec2<int> xy = origin + scroll + container->cursor;
         Rectangle<int> rect(xy, wh);
-        ui_clip(rect);
-        ui_draw_text(label, xy + Vec2<int>(style.padding, style.padding), style.font_size, Color::white());
-        ui_clip_end();
+        clip(rect);
+        draw_text(label, xy + Vec2<int>(style.padding, style.padding), style.font_size, Color::white());
+        clip_end();
+        update_cursor(wh);
+    }
+
+    /* an image from the backend (the sprite atlas of sprite.h for the
+     * software and raylib ones), padded like a label */
+    void image(int image) {
+        const Vec2<int> size = ui_get_image_size(image);
+        Vec2<int> wh = get_widget_size(size.x + 2 * style.padding, size.y + 2 * style.padding);
+        Container *container = current_container();
+        ui_assert(container != NULL);
+        Vec2<int> origin = container->bounds.xy();
+        Vec2<int> xy = origin + scroll + container->cursor;
+        Rectangle<int> rect(xy, wh);
+        clip(rect);
+        draw_image(image, xy + Vec2<int>(style.padding, style.padding));
+        clip_end();
+        update_cursor(wh);
+    }
+
+    /* text wrapped to the width set by set_next_widget_size, or else to the
+     * rest of the screen's width. name keys the cached line breaks (see
+     * TextLayout), and only the lines on screen are drawn. With tail, a
+     * paragraph sized shorter than its text shows its last lines instead of
+     * its first ones, as a log would. */
+    void paragraph(const char *name, const char *text, bool tail = false) {
+        ui_id id = id_stack.get_id(name, strlen(name));
+        Container *container = current_container();
+        ui_assert(container != NULL);
+        Vec2<int> origin = container->bounds.xy();
+        Vec2<int> xy = origin + scroll + container->cursor;
+        const bool sized = has_next_widget_size;
+        Vec2<int> wh = get_widget_size(screen_size.x - (origin.x + container->cursor.x) - style.h_margin, 0);
+        TextLayout &layout = text_layout(id);
+        // a glyph fits in a cell of font_size, at least one per line
+        layout.update(text, std::max(wh.x - 2 * style.padding, style.font_size), style.font_size);
+        const int line_height = style.font_size + style.padding;
+        const int lines = layout.lines.size();
+        if(!sized)
+            wh.y = lines * line_height + style.padding;
+        Rectangle<int> rect(xy, wh);
+        clip(rect);
+        const int top = std::max(rect.y, 0), bottom = std::min(rect.y + rect.h, screen_size.y);
+        int text_y = xy.y + style.padding;
+        if(tail)
+            text_y -= std::max(0, lines * line_height + style.padding - wh.y);
+        char buf[TextLayout::max_line_length + 1];
+        for(int i = std::max(0, (top - text_y) / line_height); i < lines; i++) {
+            const int y = text_y + i * line_height;
+            if(y >= bottom)
+                break;
+            const TextLine &line = layout.lines[i];
+            memcpy(buf, text + line.start, line.length);
+            buf[line.length] = 0;
+            draw_text(buf, Vec2<int>(xy.x + style.padding, y), style.font_size, Color::white());
+        }
+        clip_end();
         update_cursor(wh);
     }
 
@@ -358,23 +987,89 @@ public:
         new_selectable_widget(id, rect);
         if(hot_item == id && input.pressed_keys() == KEY::A)
             active_item = id;
-        ui_clip(rect);
-        ui_fill_rectangle(rect, Color::dark_grey());
+        clip(rect);
+        fill_rectangle(rect, Color::dark_grey());
         if(active_item == id)
-            ui_draw_rectangle(rect, Color::red());
+            draw_rectangle(rect, Color::red());
         else if(hot_item == id)
-            ui_draw_rectangle(rect, Color::green());
-        ui_draw_text(label, xy + Vec2<int>(style.padding, style.padding), style.font_size, Color::black());
-        ui_clip_end();
+            draw_rectangle(rect, Color::green());
+        draw_text(label, xy + Vec2<int>(style.padding, style.padding), style.font_size, Color::black());
+        clip_end();
         widgets_locations[id] = xy;
         update_cursor(wh);
         return input.pressed_keys() != KEY::A && hot_item == id && active_item == id;
     }
 
+    /* count buttons of the same size, cols per row, laid out arithmetically.
+     * A cell's id is derived from the grid's id and its index, and its text
+     * comes from cell_text(index, buf, size), which returns the string to
+     * draw (buf or any other). Only the cells on screen, and the ring around
+     * them that navigation can reach (at least the row and column nearest to
+     * the screen), are visited. set_next_widget_size sets the room the grid
+     * takes in the layout, not its cell size. Returns the index of the
+     * clicked cell, or -1. */
+    template <typename F>
+    int grid(const char *name, int count, int cols, Vec2<int> cell, F cell_text) {
+        ui_id grid_id = id_stack.get_id(name, strlen(name));
+        Container *container = current_container();
+        ui_assert(container != NULL);
+        ui_assert(cols > 0);
+        const Vec2<int> origin = container->bounds.xy() + scroll + container->cursor;
+        const Vec2<int> pitch(cell.x + style.h_margin, cell.y + style.v_margin);
+        const int rows = (count + cols - 1) / cols;
+        const Vec2<int> wh = get_widget_size(cols * pitch.x - style.h_margin, rows * pitch.y - style.v_margin);
+        // clamped to the grid, a grid off screen keeps its nearest edge
+        const int first_row = std::max(0, std::min(rows - 1, -origin.y / pitch.y - 1));
+        const int last_row = std::max(first_row, std::min(rows - 1, (screen_size.y - origin.y) / pitch.y + 1));
+        const int first_col = std::max(0, std::min(cols - 1, -origin.x / pitch.x - 1));
+        const int last_col = std::max(first_col, std::min(cols - 1, (screen_size.x - origin.x) / pitch.x + 1));
+        int clicked = -1;
+        char buf[32];
+        for(int row = first_row; row <= last_row; row++) {
+            for(int col = first_col; col <= last_col; col++) {
+                const int index = row * cols + col;
+                if(index >= count)
+                    break;
+                const ui_id id = cell_id(grid_id, index);
+                Vec2<int> xy(origin.x + col * pitch.x, origin.y + row * pitch.y);
+                Rectangle<int> rect(xy, cell);
+                new_selectable_widget(id, rect);
+                if(hot_item == id && input.pressed_keys() == KEY::A)
+                    active_item = id;
+                widgets_locations[id] = xy;
+                if(rect.x >= screen_size.x || rect.y >= screen_size.y || rect.x + rect.w <= 0 || rect.y + rect.h <= 0)
+                    continue; // only reachable, not drawn
+                clip(rect);
+                fill_rectangle(rect, Color::dark_grey());
+                if(active_item == id)
+                    draw_rectangle(rect, Color::red());
+                else if(hot_item == id)
+                    draw_rectangle(rect, Color::green());
+                draw_text(cell_text(index, buf, sizeof(buf)), xy + Vec2<int>(style.padding, style.padding), style.font_size, Color::black());
+                clip_end();
+                if(input.pressed_keys() != KEY::A && hot_item == id && active_item == id)
+                    clicked = index;
+            }
+        }
+        update_cursor(wh);
+        return clicked;
+    }
+
+    bool listbox(int *selected, const char *const *items, size_t count) {
+        return listbox(selected, items, count, items);
+    }
+
+#ifndef UI_NO_HEAP
     bool listbox(int *selected, const std::vector<std::string> &items) {
-        *selected = clamp<int>(*selected, 0, items.size());
-        const char *label = items[*selected].c_str();
-        ui_id id = id_stack.get_id((void*)&items, sizeof(&items));
+        return listbox(selected, items, items.size(), &items);
+    }
+#endif
+
+    template <typename Items>
+    bool listbox(int *selected, const Items &items, size_t count, const void *key) {
+        *selected = clamp<int>(*selected, 0, count - 1);
+        const char *label = item_text(items[*selected]);
+        ui_id id = id_stack.get_id((void*)&key, sizeof(key));
         const int w = ui_get_text_width(label, style.font_size) + 2 * style.padding;
         const int h = style.font_size + 2 * style.padding;
         Vec2<int> wh = get_widget_size(w, h);
@@ -385,7 +1080,7 @@ public:
         Rectangle<int> rect(xy, wh);
         new_selectable_widget(id, rect);
         if(hot_item == id && input.pressed_keys() == (KEY::UP | KEY::SELECT)) {
-            if(*selected < (int)(items.size() - 1))
+            if(*selected < (int)(count - 1))
                 *selected += 1;
             active_item = id;
         } else if(hot_item == id && input.pressed_keys() == (KEY::DOWN | KEY::SELECT)) {
@@ -393,14 +1088,14 @@ public:
                 *selected -= 1;
             active_item = id;
         }
-        ui_clip(rect);
-        ui_fill_rectangle(rect, Color::dark_grey());
+        clip(rect);
+        fill_rectangle(rect, Color::dark_grey());
         if(active_item == id)
-            ui_draw_rectangle(rect, Color::red());
+            draw_rectangle(rect, Color::red());
         else if(hot_item == id)
-            ui_draw_rectangle(rect, Color::green());
-        ui_draw_text(label, xy + Vec2<int>(style.padding, style.padding), style.font_size, Color::black());
-        ui_clip_end();
+            draw_rectangle(rect, Color::green());
+        draw_text(label, xy + Vec2<int>(style.padding, style.padding), style.font_size, Color::black());
+        clip_end();
         widgets_locations[id] = xy;
         update_cursor(wh);
         return input.pressed_keys() != KEY::A && hot_item == id && active_item == id;
@@ -416,16 +1111,16 @@ public:
         new_selectable_widget(id, rect);
         if(hot_item == id && input.pressed_keys() == KEY::A)
             active_item = id;
-        ui_clip(rect);
+        clip(rect);
         if(*checked)
-            ui_fill_rectangle(rect, Color::dark_grey());
+            fill_rectangle(rect, Color::dark_grey());
         if(active_item == id)
-            ui_draw_rectangle(rect, Color::red());
+            draw_rectangle(rect, Color::red());
         else if(hot_item == id)
-            ui_draw_rectangle(rect, Color::green());
+            draw_rectangle(rect, Color::green());
         else
-            ui_draw_rectangle(rect, Color::white());
-        ui_clip_end();
+            draw_rectangle(rect, Color::white());
+        clip_end();
         widgets_locations[id] = xy;
         update_cursor(wh);
         bool clicked = input.pressed_keys() != KEY::A && hot_item == id && active_item == id;
@@ -438,7 +1133,8 @@ public:
     bool input_number(T *x, T min_value, T max_value, T step = 1) {
         *x = clamp(*x, min_value, max_value);
         ui_id id = id_stack.get_id((void*)&x, sizeof(x));
-        const char *number = std::to_string(*x).c_str();
+        char number[32];
+        format_number(number, sizeof(number), *x);
         const int w = ui_get_text_width(number, style.font_size) + 2 * style.padding;
         const int h = style.font_size + 2 * style.padding;
         Vec2<int> wh = get_widget_size(w, h);
@@ -460,20 +1156,20 @@ public:
             *x = clamp(*x, min_value, max_value);
             active_item = id;
         }
-        ui_clip(rect);
-        ui_fill_rectangle(rect, Color::dark_grey());
+        clip(rect);
+        fill_rectangle(rect, Color::dark_grey());
         if(active_item == id)
-            ui_draw_rectangle(rect, Color::red());
+            draw_rectangle(rect, Color::red());
         else if(hot_item == id)
-            ui_draw_rectangle(rect, Color::green());
-        ui_draw_text(number, xy + Vec2<int>(style.padding, style.padding), style.font_size, Color::black());
-        ui_clip_end();
+            draw_rectangle(rect, Color::green());
+        draw_text(number, xy + Vec2<int>(style.padding, style.padding), style.font_size, Color::black());
+        clip_end();
         widgets_locations[id] = xy;
         update_cursor(wh);
         return (input.pressed_keys() != (KEY::UP | KEY::SELECT)) && (input.pressed_keys() != (KEY::DOWN | KEY::SELECT)) && hot_item == id && active_item == id;
     }
 
-    bool input_text(std::string &text, size_t max_size) {
+    bool input_text(String &text, size_t max_size) {
         ui_id id = id_stack.get_id(text.c_str(), text.size());
         const int w = ui_get_text_width(text.c_str(), style.font_size) + 2 * style.padding;
         const int h = style.font_size + 2 * style.padding;
@@ -485,17 +1181,19 @@ public:
         Rectangle<int> rect(xy, wh);
         new_selectable_widget(id, rect);
         if(hot_item == id && input.pressed_keys() == KEY::A) {
-            virtual_keyboard_data = new VirtualKeyboardData(text, max_size);
+            keyboard_data.text_input = &text;
+            keyboard_data.max_size = max_size;
+            virtual_keyboard_data = &keyboard_data;
             active_item = id; 
         }
-        ui_clip(rect);
-        ui_fill_rectangle(rect, Color::dark_grey());
+        clip(rect);
+        fill_rectangle(rect, Color::dark_grey());
         if(active_item == id)
-            ui_draw_rectangle(rect, Color::red());
+            draw_rectangle(rect, Color::red());
         else if(hot_item == id)
-            ui_draw_rectangle(rect, Color::green());
-        ui_draw_text(text.c_str(), xy + Vec2<int>(style.padding, style.padding), style.font_size, Color::black());
-        ui_clip_end();
+            draw_rectangle(rect, Color::green());
+        draw_text(text.c_str(), xy + Vec2<int>(style.padding, style.padding), style.font_size, Color::black());
+        clip_end();
         widgets_locations[id] = xy;
         update_cursor(wh);
         #warning TODO : handle return value / active item. The stuff below doesn't work
@@ -527,36 +1225,33 @@ public:
         if(virtual_keyboard_data == nullptr)
             return false;
         
-        std::string &text_input = virtual_keyboard_data->text_input;
-        const size_t max_size = virtual_keyboard_data->max_size;
+        String &text_input = *virtual_keyboard_data->text_input;
+        size_t max_size = virtual_keyboard_data->max_size;
+#ifdef UI_NO_HEAP
+        if(max_size == 0 || max_size > text_input.capacity())
+            max_size = text_input.capacity();
+#endif
         label(text_input.c_str());
         nextline();
 
-        const std::vector<std::vector<std::string>> keys = {
-            {"A", "Z", "E", "R", "T", "Y", "U", "I", "O", "P"},
-            {"Q", "S", "D", "F", "G", "H", "J", "K", "L", "M"},
-            {"W", "X", "C", "V", "B", "N"},
-            {"    ", "<-"}, 
-        };
-        for(int y = 0; y < keys.size(); y++) {
-            for(int x = 0; x < keys[y].size(); x++) {
-                const std::string key = keys[y][x];
-                
-                if(button(keys[y][x].c_str())) {
-                    if(key == "<-" && virtual_keyboard_data->text_input.size() > 0)
-                        text_input.pop_back();
-                    else if(text_input.size() < max_size || max_size == 0) {
-                    if(key == "    ")
-                        virtual_keyboard_data->text_input.append(" ");
-                    else
-                        virtual_keyboard_data->text_input.append(keys[y][x].c_str());
-                    }
-                }
-            }
-            nextline();
+        static const char letters[] = "AZERTYUIOPQSDFGHJKLMWXCVBN";
+        const Vec2<int> key_size(ui_get_text_width("W", style.font_size) + 2 * style.padding, style.font_size + 2 * style.padding);
+        int key = grid("keys", sizeof(letters) - 1, 10, key_size, [](int index, char *buf, size_t size) {
+            buf[0] = letters[index];
+            buf[1] = 0;
+            return (const char*)buf;
+        });
+        nextline();
+        if(key >= 0 && (text_input.size() < max_size || max_size == 0)) {
+            const char letter[2] = {letters[key], 0};
+            text_input.append(letter);
         }
+        if(button("    ") && (text_input.size() < max_size || max_size == 0))
+            text_input.append(" ");
+        if(button("<-") && text_input.size() > 0)
+            text_input.pop_back();
+        nextline();
         if(button("OK")) {
-            delete virtual_keyboard_data;
             virtual_keyboard_data = nullptr;
             return false;
         } else {
@@ -575,6 +1270,60 @@ private:
         return x;
     }
 
+    /* same output as std::to_string, without the allocation */
+    static void format_number(char *buf, size_t size, int x) { snprintf(buf, size, "%d", x); }
+    static void format_number(char *buf, size_t size, unsigned int x) { snprintf(buf, size, "%u", x); }
+    static void format_number(char *buf, size_t size, long x) { snprintf(buf, size, "%ld", x); }
+    static void format_number(char *buf, size_t size, unsigned long x) { snprintf(buf, size, "%lu", x); }
+    static void format_number(char *buf, size_t size, double x) { snprintf(buf, size, "%f", x); }
+    /* as many decimals as the fractional bits can tell apart, truncated */
+    template <int FRAC>
+    static void format_number(char *buf, size_t size, Fixed<FRAC> x) {
+        const int64_t raw = x.raw;
+        const uint64_t magnitude = raw < 0 ? -raw : raw;
+        uint32_t fraction = magnitude & (Fixed<FRAC>::one - 1);
+        int n = snprintf(buf, size, "%s%lu.", raw < 0 ? "-" : "", (unsigned long)(magnitude >> FRAC));
+        for(int digits = std::max(FRAC * 3 / 10, 1); digits > 0 && n > 0 && (size_t)n + 1 < size; digits--) {
+            fraction *= 10;
+            buf[n++] = '0' + (fraction >> FRAC);
+            buf[n] = 0;
+            fraction &= Fixed<FRAC>::one - 1;
+        }
+    }
+
+    /* id of a grid cell, one multiply instead of hashing a label */
+    static ui_id cell_id(ui_id grid_id, int index) {
+        ui_id id = (grid_id ^ (ui_id)index) * 0x9e3779b1u;
+        id ^= id >> 16;
+        return id != 0 ? id : 1;
+    }
+
+    /* the cached layout of a paragraph, or the least recently used one
+     * recycled for it */
+    TextLayout &text_layout(ui_id id) {
+        TextLayout *victim = nullptr;
+        for(auto &layout : text_layouts) {
+            if(layout.id == id) {
+                layout.last_use = frame;
+                return layout;
+            }
+            if(victim == nullptr || layout.last_use < victim->last_use)
+                victim = &layout;
+        }
+        if(text_layouts.size() < UI_MAX_TEXT_LAYOUTS) {
+            text_layouts.push_back(TextLayout());
+            victim = &text_layouts.back();
+        }
+        victim->reset(id);
+        victim->last_use = frame;
+        return *victim;
+    }
+
+    static const char *item_text(const char *item) { return item; }
+#ifndef UI_NO_HEAP
+    static const char *item_text(const std::string &item) { return item.c_str(); }
+#endif
+
     void new_selectable_widget(ui_id id, Rectangle<int> bounds) {
         if(hot_item == 0)
             hot_item = id;
@@ -589,19 +1338,108 @@ private:
         }
     }
 
+    // Drawing, everything goes through here on its way to the backend (or the draw list)
+
+    void hash_bytes(const void *data, size_t size) {
+        const unsigned char *p = (const unsigned char*)data;
+        while(size--)
+            hash = (hash ^ *p++) * FNV_PRIME;
+    }
+
+    void hash_command(DRAW_OP op, Rectangle<int> rect, Color color) {
+        int32_t v[5] = {op, rect.x, rect.y, rect.w, rect.h};
+        uint8_t c[4] = {color.r, color.g, color.b, color.a};
+        hash_bytes(v, sizeof(v));
+        hash_bytes(c, sizeof(c));
+    }
+
+    void draw_rectangle(Rectangle<int> rect, Color color) {
+        if(frame_hash_enabled)
+            hash_command(DRAW_RECTANGLE, rect, color);
+        if(draw_list != nullptr)
+            draw_list->push(DRAW_RECTANGLE, rect, color);
+        else
+            ui_draw_rectangle(rect, color);
+    }
+
+    void fill_rectangle(Rectangle<int> rect, Color color) {
+        if(frame_hash_enabled)
+            hash_command(FILL_RECTANGLE, rect, color);
+        if(draw_list != nullptr)
+            draw_list->push(FILL_RECTANGLE, rect, color);
+        else
+            ui_fill_rectangle(rect, color);
+    }
+
+    void draw_text(const char *msg, Vec2<int> pos, int font_size, Color color) {
+        if(frame_hash_enabled) {
+            hash_command(DRAW_TEXT, Rectangle<int>(pos.x, pos.y, font_size, 0), color);
+            hash_bytes(msg, strlen(msg));
+        }
+        if(draw_list != nullptr)
+            draw_list->push(DRAW_TEXT, Rectangle<int>(pos.x, pos.y, font_size, 0), color, msg);
+        else
+            ui_draw_text(msg, pos, font_size, color);
+    }
+
+    void draw_image(int image, Vec2<int> pos) {
+        if(frame_hash_enabled)
+            hash_command(DRAW_IMAGE, Rectangle<int>(pos.x, pos.y, image, 0), Color(0, 0, 0, 0));
+        if(draw_list != nullptr)
+            draw_list->push(DRAW_IMAGE, Rectangle<int>(pos.x, pos.y, image, 0), Color(0, 0, 0, 0));
+        else
+            ui_draw_image(image, pos);
+    }
+
+    void clip(Rectangle<int> rect) {
+        if(frame_hash_enabled)
+            hash_command(CLIP, rect, Color(0, 0, 0, 0));
+        if(draw_list != nullptr)
+            draw_list->push(CLIP, rect, Color(0, 0, 0, 0));
+        else
+            ui_clip(rect);
+    }
+
+    void clip_end() {
+        if(frame_hash_enabled)
+            hash_command(CLIP_END, Rectangle<int>(0, 0, 0, 0), Color(0, 0, 0, 0));
+        if(draw_list != nullptr)
+            draw_list->push(CLIP_END, Rectangle<int>(0, 0, 0, 0), Color(0, 0, 0, 0));
+        else
+            ui_clip_end();
+    }
+
+    /* returns true if the hot item changed */
+    bool navigate() {
+        Vec2<int> dir;
+        if(input.pressed_keys() == KEY::UP)
+            dir.y--;
+        if(input.pressed_keys() == KEY::DOWN)
+            dir.y++;
+        if(input.pressed_keys() == KEY::LEFT)
+            dir.x--;
+        if(input.pressed_keys() == KEY::RIGHT)
+            dir.x++;
+        if(dir.x == 0 && dir.y == 0)
+            return false;
+        ui_id previous = hot_item;
+        update_hot_item_by_direction(dir);
+        return hot_item != previous;
+    }
+
     void update_hot_item_by_direction(Vec2<int> dir) {
         if(hot_item == 0) return;
         if(widgets_locations.count(hot_item) == 0) return;
         Vec2<int> hot_item_loc = widgets_locations[hot_item];
-        int best_distance = INT_MAX;
+        int64_t best_distance = INT64_MAX;
         ui_id best_id = 0;
         for(auto& it: widgets_locations) {
             ui_id id = it.first;
             if(id == hot_item)
                 continue;
             Vec2<int> loc = it.second;
-            int distance = (loc - hot_item_loc).mag_squared();
-            int dot = (loc - hot_item_loc).dot(dir);
+            int64_t distance = (loc - hot_item_loc).mag_squared();
+            int64_t dot = (loc - hot_item_loc).dot(dir);
             if(dot > 0 && distance < best_distance) {
                 best_distance = distance;
                 best_id = id;
@@ -615,23 +1453,19 @@ private:
 
     void update_cursor(Vec2<int> wh) {
         if(container_stack.empty()) return;
-        container_stack.back()->update_cursor(wh + Vec2<int>(style.h_margin, 0));
+        container_stack.back().update_cursor(wh + Vec2<int>(style.h_margin, 0));
     }
 
     void push_container() {
-        Container *parent = container_stack.empty() ? nullptr : container_stack.back();
-        Container *new_container = nullptr;
-        if(parent == nullptr)
-            new_container = new Container(Vec2<int>(0,0));
+        if(container_stack.empty())
+            container_stack.push_back(Container(Vec2<int>(0,0)));
         else
-            new_container = new Container(parent->cursor);
-        container_stack.push_back(new_container);
+            container_stack.push_back(Container(container_stack.back().cursor));
     }
 
     void pop_container() {
-        Container *container = current_container();
+        Vec2<int> wh = current_container()->bounds.wh();
         container_stack.pop_back();
-        Vec2<int> wh = container->bounds.wh();
         if(container_stack.empty()) {
             content_size = wh;
         }
@@ -640,43 +1474,66 @@ private:
 
     Container *current_container() {
         ui_assert(!container_stack.empty());
-        return container_stack.back();
+        return &container_stack.back();
     }
 
     // Special widgets
 
+    /* the sliders scale the scroll by screen / content size, a quotient only
+     * worked out again when the content size changes : no divisions per frame */
+    void update_slider_scale() {
+        if(content_size.x == slider_content.x && content_size.y == slider_content.y)
+            return;
+        slider_content = content_size;
+        slider_scale.x = content_size.x > 0 ? fixed::ratio(screen_size.x, content_size.x) : fixed(0);
+        slider_scale.y = content_size.y > 0 ? fixed::ratio(screen_size.y, content_size.y) : fixed(0);
+    }
+
     void draw_h_slider() {
         int slider_w = style.slider_width;
         int screen_w = screen_size.x;
         int screen_h = screen_size.y;
-        ui_fill_rectangle(Rectangle<int>(0, screen_h - slider_w, screen_w, slider_w), Color::dark_grey());
-        int x = -scroll.x * screen_w / content_size.x;
-        int w = screen_w * screen_w / content_size.x;
-        ui_fill_rectangle(Rectangle<int>(x, screen_h - slider_w, w, slider_w), Color::light_grey());
+        fill_rectangle(Rectangle<int>(0, screen_h - slider_w, screen_w, slider_w), Color::dark_grey());
+        int x = slider_scale.x.times(-scroll.x);
+        int w = slider_scale.x.times(screen_w);
+        fill_rectangle(Rectangle<int>(x, screen_h - slider_w, w, slider_w), Color::light_grey());
     }
 
     void draw_v_slider() {
         int slider_w = style.slider_width;
         int screen_w = screen_size.x;
         int screen_h = screen_size.y;
-        ui_fill_rectangle(Rectangle<int>(screen_w - slider_w, 0, slider_w, screen_h), Color::dark_grey());
-        int y = -scroll.y * screen_h / content_size.y;
-        int h = screen_h * screen_h / content_size.y;
-        ui_fill_rectangle(Rectangle<int>(screen_w - slider_w, y, slider_w, h), Color::light_grey());
+        fill_rectangle(Rectangle<int>(screen_w - slider_w, 0, slider_w, screen_h), Color::dark_grey());
+        int y = slider_scale.y.times(-scroll.y);
+        int h = slider_scale.y.times(screen_h);
+        fill_rectangle(Rectangle<int>(screen_w - slider_w, y, slider_w, h), Color::light_grey());
     }
     struct Input input;
     ui_id hot_item, active_item;
     bool hot_item_exists;
     int frame;
     Style style;
-    std::unordered_map<ui_id, Vec2<int>> widgets_locations;
+    Map<ui_id, Vec2<int>, UI_MAX_WIDGETS> widgets_locations;
     IDStack id_stack;
-    std::vector<Container*> container_stack;
+    Vector<Container, UI_MAX_CONTAINERS> container_stack;
     Vec2<int> content_size;
+    Vec2<int> slider_content = Vec2<int>(-1, -1); // content size slider_scale is for
+    Vec2<fixed> slider_scale;
     Vec2<int> screen_size;
     Vec2<int> scroll; /* global scrolling (i decided to not support per-container scrolling)*/
-    Vec2<int> *next_widget_size = nullptr;
-    VirtualKeyboardData *virtual_keyboard_data = nullptr;
+    Vec2<int> next_widget_size;
+    bool has_next_widget_size = false;
+    Vector<TextLayout, UI_MAX_TEXT_LAYOUTS> text_layouts;
+    VirtualKeyboardData keyboard_data;
+    VirtualKeyboardData *virtual_keyboard_data = nullptr; // points to keyboard_data while the keyboard is displayed
+    DrawList *draw_list = nullptr;
+    bool frame_hash_enabled = false;
+    ui_id hash = 0;
+    bool immediate_navigation = false;
+    bool frame_has_edge = false, new_has_edge = false, deferred_has_edge = false;
+    unsigned long frame_edge_time = 0, new_edge_time = 0, deferred_edge_time = 0;
+    LatencyStats latency;
+    static const ui_id FNV_PRIME = 16777619, FNV_OFFSET_BASIS = 2166136261;
 };
 
 